@@ -0,0 +1,582 @@
+#include "simulator/w5500.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <chrono>
+
+using namespace Project::wizchip::simulator;
+
+// common registers
+static constexpr uint16_t MR = 0x0000;
+static constexpr uint16_t SIPR = 0x000F;
+static constexpr uint16_t IR = 0x0015;
+static constexpr uint16_t IMR = 0x0016;
+static constexpr uint16_t SIR = 0x0017;
+static constexpr uint16_t SIMR = 0x0018;
+static constexpr uint16_t RTR = 0x0019;
+static constexpr uint16_t RCR = 0x001B;
+static constexpr uint16_t PHYCFGR = 0x002E;
+static constexpr uint16_t VERSIONR = 0x0039;
+
+// socket registers
+static constexpr uint16_t Sn_MR = 0x00;
+static constexpr uint16_t Sn_CR = 0x01;
+static constexpr uint16_t Sn_IR = 0x02;
+static constexpr uint16_t Sn_SR = 0x03;
+static constexpr uint16_t Sn_PORT = 0x04;
+static constexpr uint16_t Sn_DIPR = 0x0C;
+static constexpr uint16_t Sn_DPORT = 0x10;
+static constexpr uint16_t Sn_MSSR = 0x12;
+static constexpr uint16_t Sn_TTL = 0x16;
+static constexpr uint16_t Sn_RXBUF_SIZE = 0x1E;
+static constexpr uint16_t Sn_TXBUF_SIZE = 0x1F;
+static constexpr uint16_t Sn_TX_FSR = 0x20;
+static constexpr uint16_t Sn_TX_RD = 0x22;
+static constexpr uint16_t Sn_TX_WR = 0x24;
+static constexpr uint16_t Sn_RX_RSR = 0x26;
+static constexpr uint16_t Sn_RX_RD = 0x28;
+static constexpr uint16_t Sn_RX_WR = 0x2A;
+static constexpr uint16_t Sn_IMR = 0x2C;
+static constexpr uint16_t Sn_FRAG = 0x2D;
+
+// Sn_MR protocol
+static constexpr uint8_t MODE_TCP = 0x01;
+static constexpr uint8_t MODE_UDP = 0x02;
+
+// Sn_CR
+static constexpr uint8_t CMD_OPEN = 0x01;
+static constexpr uint8_t CMD_LISTEN = 0x02;
+static constexpr uint8_t CMD_CONNECT = 0x04;
+static constexpr uint8_t CMD_DISCON = 0x08;
+static constexpr uint8_t CMD_CLOSE = 0x10;
+static constexpr uint8_t CMD_SEND = 0x20;
+static constexpr uint8_t CMD_SEND_MAC = 0x21;
+static constexpr uint8_t CMD_SEND_KEEP = 0x22;
+static constexpr uint8_t CMD_RECV = 0x40;
+
+// Sn_IR
+static constexpr uint8_t IR_CON = 0x01;
+static constexpr uint8_t IR_DISCON = 0x02;
+static constexpr uint8_t IR_RECV = 0x04;
+static constexpr uint8_t IR_TIMEOUT = 0x08;
+static constexpr uint8_t IR_SENDOK = 0x10;
+
+// Sn_SR
+static constexpr uint8_t SOCK_CLOSED = 0x00;
+static constexpr uint8_t SOCK_INIT = 0x13;
+static constexpr uint8_t SOCK_LISTEN = 0x14;
+static constexpr uint8_t SOCK_ESTABLISHED = 0x17;
+static constexpr uint8_t SOCK_CLOSE_WAIT = 0x1C;
+static constexpr uint8_t SOCK_UDP = 0x22;
+
+static uint16_t get16(const uint8_t* regs, uint16_t offset) {
+    return uint16_t(regs[offset] << 8 | regs[offset + 1]);
+}
+
+static void set16(uint8_t* regs, uint16_t offset, uint16_t value) {
+    regs[offset] = value >> 8;
+    regs[offset + 1] = value & 0xFF;
+}
+
+static int set_nonblocking(int fd) {
+    return ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static sockaddr_in make_address(const std::string& ip, uint16_t port) {
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    ::inet_pton(AF_INET, ip.c_str(), &addr.sin_addr);
+    return addr;
+}
+
+W5500::W5500(Args args) : args(std::move(args)) {
+    for (auto& fd : listen_fd) fd = -1;
+    reset();
+}
+
+W5500::~W5500() {
+    stop();
+    for (int sn = 0; sn < 8; ++sn) sock_close(sn);
+}
+
+void W5500::start() {
+    if (running.exchange(true))
+        return;
+    thread = std::thread([this] { execute(); });
+}
+
+void W5500::stop() {
+    if (not running.exchange(false))
+        return;
+    thread.join();
+}
+
+void W5500::reset() {
+    std::memset(common, 0, sizeof(common));
+    set16(common, RTR, 2000);
+    common[RCR] = 8;
+    common[PHYCFGR] = 0xBF; // link up, 100 Mbps, full duplex
+    common[VERSIONR] = 0x04;
+
+    for (int sn = 0; sn < 8; ++sn) {
+        sock_close(sn);
+        auto& regs = sockets[sn].regs;
+        std::memset(regs, 0, sizeof(regs));
+        set16(regs, Sn_MSSR, 0xFFFF);
+        regs[Sn_TTL] = 0x80;
+        regs[Sn_RXBUF_SIZE] = 2;
+        regs[Sn_TXBUF_SIZE] = 2;
+        set16(regs, Sn_TX_FSR, 2048);
+        regs[Sn_IMR] = 0xFF;
+        set16(regs, Sn_FRAG, 0x4000);
+    }
+}
+
+void W5500::select() {
+    mutex.lock();
+    frame_len = 0;
+    frame_bytes = 0;
+    frame_transfers = 0;
+    stats.frames++;
+}
+
+void W5500::deselect() {
+    if (args.spi_clock || args.transfer_ns) {
+        // the bus stays busy for the clocking time of the frame and the setup of its transfers
+        uint64_t ns = uint64_t(frame_transfers) * args.transfer_ns;
+        if (args.spi_clock) ns += uint64_t(frame_bytes) * 8 * 1'000'000'000 / args.spi_clock;
+        auto duration = std::chrono::nanoseconds(ns);
+        auto until = std::chrono::steady_clock::now() + duration;
+        while (std::chrono::steady_clock::now() < until) {}
+    }
+
+    bool edge = update_intn();
+    mutex.unlock();
+    if (edge and on_interrupt) on_interrupt();
+}
+
+void W5500::read(uint8_t* buf, uint16_t len) {
+    frame_bytes += len;
+    frame_transfers++;
+    stats.transfers++;
+    stats.bytes += len;
+    for (uint16_t i = 0; i < len; ++i) {
+        if (frame_len < 3) {
+            buf[i] = 0;
+            continue;
+        }
+        buf[i] = read_byte(frame[2] >> 3, frame_address++);
+    }
+}
+
+void W5500::write(const uint8_t* buf, uint16_t len) {
+    frame_bytes += len;
+    frame_transfers++;
+    stats.transfers++;
+    stats.bytes += len;
+    for (uint16_t i = 0; i < len; ++i) {
+        if (frame_len < 3) {
+            frame[frame_len++] = buf[i];
+            frame_address = uint16_t(frame[0] << 8 | frame[1]);
+            continue;
+        }
+        write_byte(frame[2] >> 3, frame_address++, buf[i]);
+    }
+}
+
+uint16_t W5500::tx_size(int sn) const {
+    return uint16_t(sockets[sn].regs[Sn_TXBUF_SIZE] << 10);
+}
+
+uint16_t W5500::rx_size(int sn) const {
+    return uint16_t(sockets[sn].regs[Sn_RXBUF_SIZE] << 10);
+}
+
+uint8_t W5500::read_byte(uint8_t block, uint16_t address) {
+    if (block == 0) {
+        if (address == SIR) {
+            uint8_t sir = 0;
+            for (int sn = 0; sn < 8; ++sn) if (sockets[sn].regs[Sn_IR]) sir |= 1 << sn;
+            return sir;
+        }
+        return address < sizeof(common) ? common[address] : 0;
+    }
+
+    int sn = block >> 2;
+    auto& s = sockets[sn];
+    switch (block & 0x03) {
+        case 1: {
+            if (address >= sizeof(s.regs)) return 0;
+            if (address == Sn_TX_FSR || address == Sn_TX_FSR + 1) {
+                set16(s.regs, Sn_TX_FSR, tx_size(sn) - uint16_t(get16(s.regs, Sn_TX_WR) - get16(s.regs, Sn_TX_RD)));
+            }
+            if (address == Sn_RX_RSR || address == Sn_RX_RSR + 1) {
+                set16(s.regs, Sn_RX_RSR, uint16_t(get16(s.regs, Sn_RX_WR) - get16(s.regs, Sn_RX_RD)));
+            }
+            return s.regs[address];
+        }
+        case 2: return tx_size(sn) ? s.tx[address % tx_size(sn)] : 0;
+        case 3: return rx_size(sn) ? s.rx[address % rx_size(sn)] : 0;
+        default: return 0;
+    }
+}
+
+void W5500::write_byte(uint8_t block, uint16_t address, uint8_t value) {
+    if (block == 0) {
+        if (address == MR && (value & 0x80)) {
+            reset();
+        } else if (address == IR) {
+            common[IR] &= ~value;
+        } else if (address != SIR && address != VERSIONR && address < sizeof(common)) {
+            common[address] = value;
+        }
+        return;
+    }
+
+    int sn = block >> 2;
+    auto& s = sockets[sn];
+    switch (block & 0x03) {
+        case 1:
+            switch (address) {
+                case Sn_CR: command(sn, value); break;
+                case Sn_IR: s.regs[Sn_IR] &= ~value; break;
+                case Sn_SR:
+                case Sn_TX_FSR: case Sn_TX_FSR + 1:
+                case Sn_TX_RD: case Sn_TX_RD + 1:
+                case Sn_RX_RSR: case Sn_RX_RSR + 1:
+                case Sn_RX_WR: case Sn_RX_WR + 1:
+                    break;
+                default:
+                    if (address < sizeof(s.regs)) s.regs[address] = value;
+                    break;
+            }
+            break;
+        case 2: if (tx_size(sn)) s.tx[address % tx_size(sn)] = value; break;
+        case 3: if (rx_size(sn)) s.rx[address % rx_size(sn)] = value; break;
+        default: break;
+    }
+}
+
+void W5500::raise(int sn, uint8_t ir) {
+    // a masked Sn_IMR bit also keeps the Sn_IR bit from being set
+    sockets[sn].regs[Sn_IR] |= ir & sockets[sn].regs[Sn_IMR];
+}
+
+bool W5500::update_intn() {
+    uint8_t sir = 0;
+    for (int sn = 0; sn < 8; ++sn) if (sockets[sn].regs[Sn_IR]) sir |= 1 << sn;
+
+    bool asserted = (sir & common[SIMR]) || (common[IR] & common[IMR]);
+    bool edge = asserted and not _intn_asserted;
+    _intn_asserted = asserted;
+    return edge;
+}
+
+auto W5500::remote(int sn) const -> Remote {
+    auto& regs = sockets[sn].regs;
+    auto port = get16(regs, Sn_DPORT);
+    if (args.route) {
+        return args.route(&regs[Sn_DIPR], port);
+    }
+    return {"127.0.0.1", port};
+}
+
+void W5500::command(int sn, uint8_t cr) {
+    switch (cr) {
+        case CMD_OPEN: sock_open(sn); break;
+        case CMD_LISTEN: sock_listen(sn); break;
+        case CMD_CONNECT: sock_connect(sn); break;
+        case CMD_DISCON:
+            sock_close(sn);
+            raise(sn, IR_DISCON);
+            break;
+        case CMD_CLOSE: sock_close(sn); break;
+        case CMD_SEND:
+        case CMD_SEND_MAC:
+            sock_send(sn);
+            break;
+        case CMD_SEND_KEEP: break;
+        case CMD_RECV: sock_receive(sn); break;
+        default: break;
+    }
+    // command register is cleared once the command is accepted
+    sockets[sn].regs[Sn_CR] = 0;
+}
+
+void W5500::sock_open(int sn) {
+    sock_close(sn);
+    auto& regs = sockets[sn].regs;
+    set16(regs, Sn_TX_RD, 0);
+    set16(regs, Sn_TX_WR, 0);
+    set16(regs, Sn_RX_RD, 0);
+    set16(regs, Sn_RX_WR, 0);
+
+    switch (regs[Sn_MR] & 0x0F) {
+        case MODE_TCP:
+            regs[Sn_SR] = SOCK_INIT;
+            break;
+
+        case MODE_UDP: {
+            int fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            auto addr = make_address(args.host, get16(regs, Sn_PORT) + args.port_offset);
+            if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                std::fprintf(stderr, "w5500 sim: socket %d udp bind %d: %s\n", sn, get16(regs, Sn_PORT), std::strerror(errno));
+            }
+            set_nonblocking(fd);
+            sockets[sn].fd = fd;
+            regs[Sn_SR] = SOCK_UDP;
+            break;
+        }
+
+        default:
+            std::fprintf(stderr, "w5500 sim: socket %d unsupported mode 0x%02x\n", sn, regs[Sn_MR]);
+            regs[Sn_SR] = SOCK_CLOSED;
+            break;
+    }
+}
+
+void W5500::sock_listen(int sn) {
+    auto& regs = sockets[sn].regs;
+    if (regs[Sn_SR] != SOCK_INIT)
+        return;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    // the chip listens on the same port with several sockets, let the kernel balance between them
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one));
+
+    auto port = get16(regs, Sn_PORT) + args.port_offset;
+    auto addr = make_address(args.host, port);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 1) < 0) {
+        std::fprintf(stderr, "w5500 sim: socket %d listen %d: %s\n", sn, port, std::strerror(errno));
+        ::close(fd);
+        regs[Sn_SR] = SOCK_CLOSED;
+        return;
+    }
+
+    set_nonblocking(fd);
+    listen_fd[sn] = fd;
+    regs[Sn_SR] = SOCK_LISTEN;
+}
+
+void W5500::sock_connect(int sn) {
+    auto& regs = sockets[sn].regs;
+    if (regs[Sn_SR] != SOCK_INIT)
+        return;
+
+    auto [ip, port] = remote(sn);
+    auto addr = make_address(ip, port);
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    set_nonblocking(fd);
+
+    // the connection is established synchronously, bounded by the retransmission timeout of the chip
+    int timeout_ms = get16(common, RTR) / 10 * (common[RCR] + 1);
+    int res = ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    if (res < 0 && errno == EINPROGRESS) {
+        pollfd pfd = {fd, POLLOUT, 0};
+        int err = ETIMEDOUT;
+        socklen_t len = sizeof(err);
+        if (::poll(&pfd, 1, timeout_ms) == 1) ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+        res = err == 0 ? 0 : -1;
+    }
+
+    if (res < 0) {
+        ::close(fd);
+        regs[Sn_SR] = SOCK_CLOSED;
+        raise(sn, IR_TIMEOUT);
+        return;
+    }
+
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    sockets[sn].fd = fd;
+    regs[Sn_SR] = SOCK_ESTABLISHED;
+    raise(sn, IR_CON);
+}
+
+void W5500::sock_close(int sn) {
+    auto& s = sockets[sn];
+    if (s.fd >= 0) ::close(s.fd);
+    if (listen_fd[sn] >= 0) ::close(listen_fd[sn]);
+    s.fd = -1;
+    listen_fd[sn] = -1;
+    s.sending.clear();
+    s.regs[Sn_SR] = SOCK_CLOSED;
+}
+
+void W5500::sock_send(int sn) {
+    auto& s = sockets[sn];
+    auto& regs = s.regs;
+    auto size = tx_size(sn);
+    auto rd = get16(regs, Sn_TX_RD);
+    auto wr = get16(regs, Sn_TX_WR);
+    uint16_t len = wr - rd;
+
+    if (s.fd < 0 || size == 0 || len > size) {
+        raise(sn, IR_TIMEOUT);
+        return;
+    }
+
+    if (regs[Sn_SR] == SOCK_UDP) {
+        std::vector<uint8_t> data(len);
+        for (uint16_t i = 0; i < len; ++i) data[i] = s.tx[uint16_t(rd + i) % size];
+
+        auto [ip, port] = remote(sn);
+        auto addr = make_address(ip, port);
+        ::sendto(s.fd, data.data(), len, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        set16(regs, Sn_TX_RD, wr);
+        raise(sn, IR_SENDOK);
+        return;
+    }
+
+    // TX_RD..TX_WR starts with the bytes of a SEND still in progress, only the ones after them are new
+    for (uint16_t i = s.sending.size(); i < len; ++i) s.sending.push_back(s.tx[uint16_t(rd + i) % size]);
+    if (s.sending.empty()) {
+        raise(sn, IR_SENDOK);
+        return;
+    }
+
+    // the network thread hands the rest to the host socket as it drains, SENDOK is raised once all of it is taken.
+    // A peer that does not read only holds up this socket, the bus stays free
+    flush(sn);
+}
+
+void W5500::flush(int sn) {
+    auto& s = sockets[sn];
+    if (s.sending.empty())
+        return;
+
+    size_t sent = 0;
+    while (sent < s.sending.size()) {
+        auto n = ::send(s.fd, s.sending.data() + sent, s.sending.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) 
+            break;
+        if (n <= 0) {
+            s.sending.clear();
+            sock_close(sn);
+            raise(sn, IR_TIMEOUT);
+            return;
+        }
+        sent += n;
+    }
+
+    // TX_RD follows the bytes taken, as the chip frees its buffer while the data is acknowledged
+    s.sending.erase(s.sending.begin(), s.sending.begin() + sent);
+    set16(s.regs, Sn_TX_RD, get16(s.regs, Sn_TX_RD) + sent);
+    if (s.sending.empty()) {
+        raise(sn, IR_SENDOK);
+    }
+}
+
+void W5500::sock_receive(int) {
+    // RX_RD has been advanced by the host, the freed space is refilled by the network thread
+}
+
+void W5500::poll_sockets() {
+    uint8_t buf[2048];
+
+    for (int sn = 0; sn < 8; ++sn) {
+        auto& s = sockets[sn];
+        auto& regs = s.regs;
+
+        if (regs[Sn_SR] == SOCK_LISTEN) {
+            sockaddr_in peer = {};
+            socklen_t len = sizeof(peer);
+            int fd = ::accept(listen_fd[sn], reinterpret_cast<sockaddr*>(&peer), &len);
+            if (fd < 0) continue;
+
+            // the chip stops listening once a connection is accepted
+            ::close(listen_fd[sn]);
+            listen_fd[sn] = -1;
+
+            int one = 1;
+            set_nonblocking(fd);
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            s.fd = fd;
+            std::memcpy(&regs[Sn_DIPR], &peer.sin_addr, 4);
+            set16(regs, Sn_DPORT, ntohs(peer.sin_port));
+            regs[Sn_SR] = SOCK_ESTABLISHED;
+            raise(sn, IR_CON);
+        }
+
+        if (s.fd >= 0) flush(sn);
+
+        auto size = rx_size(sn);
+        if (s.fd < 0 || size == 0)
+            continue;
+
+        auto wr = get16(regs, Sn_RX_WR);
+        uint16_t free = size - uint16_t(wr - get16(regs, Sn_RX_RD));
+
+        if (regs[Sn_SR] == SOCK_ESTABLISHED) {
+            if (free == 0) continue;
+
+            auto n = ::recv(s.fd, buf, std::min<size_t>(free, sizeof(buf)), 0);
+            if (n == 0) {
+                regs[Sn_SR] = SOCK_CLOSE_WAIT;
+                raise(sn, IR_DISCON);
+            } else if (n > 0) {
+                for (ssize_t i = 0; i < n; ++i) s.rx[uint16_t(wr + i) % size] = buf[i];
+                set16(regs, Sn_RX_WR, wr + n);
+                raise(sn, IR_RECV);
+            } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                sock_close(sn);
+                raise(sn, IR_DISCON);
+            }
+        } else if (regs[Sn_SR] == SOCK_UDP) {
+            sockaddr_in peer = {};
+            socklen_t len = sizeof(peer);
+            auto n = ::recvfrom(s.fd, buf, sizeof(buf), MSG_PEEK, reinterpret_cast<sockaddr*>(&peer), &len);
+            if (n < 0 || n + 8 > free) continue;
+
+            n = ::recvfrom(s.fd, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&peer), &len);
+
+            // UDP packets are stored with the header of peer address, peer port and data length
+            uint8_t header[8];
+            std::memcpy(header, &peer.sin_addr, 4);
+            set16(header, 4, ntohs(peer.sin_port));
+            set16(header, 6, uint16_t(n));
+            for (int i = 0; i < 8; ++i) s.rx[uint16_t(wr + i) % size] = header[i];
+            for (ssize_t i = 0; i < n; ++i) s.rx[uint16_t(wr + 8 + i) % size] = buf[i];
+            set16(regs, Sn_RX_WR, wr + 8 + n);
+            raise(sn, IR_RECV);
+        }
+    }
+}
+
+void W5500::execute() {
+    while (running) {
+        pollfd fds[16];
+        int n = 0;
+        {
+            std::lock_guard lock(mutex);
+            for (int sn = 0; sn < 8; ++sn) {
+                auto& s = sockets[sn];
+                if (s.fd >= 0) fds[n++] = {s.fd, short(s.sending.empty() ? POLLIN : POLLIN | POLLOUT), 0};
+                if (listen_fd[sn] >= 0) fds[n++] = {listen_fd[sn], POLLIN, 0};
+            }
+        }
+
+        ::poll(fds, n, 1);
+
+        bool edge;
+        {
+            std::lock_guard lock(mutex);
+            poll_sockets();
+            edge = update_intn();
+        }
+        if (edge and on_interrupt) on_interrupt();
+    }
+}
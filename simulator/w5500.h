@@ -0,0 +1,104 @@
+#ifndef WIZCHIP_SIMULATOR_W5500_H
+#define WIZCHIP_SIMULATOR_W5500_H
+
+#include "wizchip/bus.h"
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Project::wizchip::simulator {
+    /// Register level model of a W5500 with 8 sockets, bridged to the host network stack.
+    /// Every chip socket is backed by a Linux socket, so the library can run on a workstation
+    class W5500 : public Bus {
+    public:
+        struct Remote {
+            std::string ip;
+            uint16_t port;
+        };
+
+        /// Arguments structure for initializing the simulator.
+        struct Args {
+            std::string host = "127.0.0.1";         ///< address the listening sockets are bound to.
+            int port_offset = 0;                    ///< added to the port of the listening sockets.
+            std::function<Remote(const uint8_t* ip, uint16_t port)> route = {}; ///< maps a chip destination to a host endpoint, loopback when empty.
+            uint32_t spi_clock = 0;                 ///< modeled SPI clock in Hz, each frame holds the bus for its clocking time. 0 disables.
+            uint32_t transfer_ns = 0;               ///< modeled setup time of each transfer, e.g. a HAL call, added to the clocking time.
+        };
+
+        explicit W5500(Args args);
+        W5500() : W5500(Args{}) {}
+        ~W5500() override;
+
+        /// disable copy constructor and assignment
+        W5500(const W5500&) = delete;
+        W5500& operator=(const W5500&) = delete;
+
+        /// start the network thread
+        void start();
+        void stop();
+
+        void select() override;
+        void deselect() override;
+        void read(uint8_t* buf, uint16_t len) override;
+        void write(const uint8_t* buf, uint16_t len) override;
+
+        /// called on INTn falling edge, from the network thread or from the thread accessing the bus
+        std::function<void()> on_interrupt = {};
+
+        /// INTn pin level
+        bool intn() const { return not _intn_asserted; }
+
+    private:
+        struct Socket {
+            uint8_t regs[0x30];
+            uint8_t tx[16 * 1024];
+            uint8_t rx[16 * 1024];
+            int fd = -1;
+            std::vector<uint8_t> sending;   ///< data of the SEND in progress not taken by the host socket yet.
+        };
+
+        void reset();
+        uint8_t read_byte(uint8_t block, uint16_t address);
+        void write_byte(uint8_t block, uint16_t address, uint8_t value);
+        void command(int sn, uint8_t cr);
+        void poll_sockets();
+        void raise(int sn, uint8_t ir);
+        bool update_intn();
+        void execute();
+
+        void sock_open(int sn);
+        void sock_listen(int sn);
+        void sock_connect(int sn);
+        void sock_close(int sn);
+        void sock_send(int sn);
+        void flush(int sn);
+        void sock_receive(int sn);
+
+        uint16_t tx_size(int sn) const;
+        uint16_t rx_size(int sn) const;
+        Remote remote(int sn) const;
+
+        Args args;
+        std::mutex mutex;
+        std::thread thread;
+        std::atomic<bool> running = false;
+
+        uint8_t common[0x40];
+        Socket sockets[8];
+        int listen_fd[8];
+
+        uint8_t frame[3];
+        int frame_len = 0;
+        uint16_t frame_address = 0;
+        uint32_t frame_bytes = 0;
+        uint32_t frame_transfers = 0;
+
+        bool _intn_asserted = false;
+        bool _intn_edge = false;
+    };
+}
+
+#endif // WIZCHIP_SIMULATOR_W5500_H
@@ -0,0 +1,49 @@
+#ifndef WIZCHIP_TESTS_ALLOC_COUNT_H
+#define WIZCHIP_TESTS_ALLOC_COUNT_H
+
+// counts every allocation of the test, included by exactly one translation unit of it.
+// operator new is replaced here, allocations from the RTOS heap are counted when the test is linked
+// with -Wl,--wrap=pvPortMalloc (wizchip_count_allocations() in tests/CMakeLists.txt)
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace Project::wizchip::test {
+    inline std::atomic<size_t> allocations = 0;
+
+    /// number of allocations made by fn
+    template <typename F>
+    size_t count_allocations(F&& fn) {
+        size_t before = allocations.load(std::memory_order_relaxed);
+        fn();
+        return allocations.load(std::memory_order_relaxed) - before;
+    }
+}
+
+void* operator new(std::size_t size) {
+    Project::wizchip::test::allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size == 0 ? 1 : size)) return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+
+extern "C" {
+    void* __real_pvPortMalloc(std::size_t size);
+
+    void* __wrap_pvPortMalloc(std::size_t size) {
+        Project::wizchip::test::allocations.fetch_add(1, std::memory_order_relaxed);
+        return __real_pvPortMalloc(size);
+    }
+}
+
+#endif // WIZCHIP_TESTS_ALLOC_COUNT_H
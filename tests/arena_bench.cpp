@@ -0,0 +1,58 @@
+#include "wizchip/http/arena.h"
+#include "tests/check.h"
+#include "etl/heap.h"
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+static void capacity() {
+    auto arena = http::Arena(256);
+    CHECK(arena.capacity() == 256);
+
+    auto a = arena.allocate(100, 1);
+    auto b = arena.allocate(8, 8);
+    CHECK(a != nullptr && b != nullptr);
+    CHECK(reinterpret_cast<uintptr_t>(b) % 8 == 0);
+    CHECK(arena.used() >= 108 && arena.used() <= 115);
+
+    CHECK(arena.allocate(200, 1) == nullptr);
+    CHECK(arena.overflows == 1);
+
+    // the high-water mark stays over resets
+    auto high_water = arena.used();
+    arena.reset();
+    CHECK(arena.used() == 0 && arena.high_water == high_water);
+    CHECK(arena.allocate(256, 1) != nullptr && arena.high_water == 256);
+    CHECK(arena.overflows == 1);
+}
+
+static void disabled() {
+    // with no block every allocation goes to the heap, that is not an overflow
+    auto arena = http::Arena();
+    CHECK(arena.allocate(16, 1) == nullptr);
+    CHECK(arena.allocate(0, 1) == nullptr);
+    CHECK(arena.overflows == 0 && arena.high_water == 0);
+}
+
+int main() {
+    capacity();
+    disabled();
+
+    // request bytes and a response head, as one request takes them
+    auto arena = http::Arena(2048);
+    bench("request and head from the arena", 100'000, [&] {
+        arena.reset();
+        keep(arena.allocate(600, 1));
+        keep(arena.allocate(180, 1));
+    });
+
+    bench("request and head from the heap", 100'000, [&] {
+        auto request = etl::vector_allocate<uint8_t>(600);
+        auto head = etl::vector_allocate<uint8_t>(180);
+        keep(request);
+        keep(head);
+    });
+
+    return result();
+}
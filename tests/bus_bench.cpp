@@ -0,0 +1,95 @@
+#include "simulator/w5500.h"
+#include "tests/check.h"
+#include "tests/chip.h"
+#include <cstring>
+
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+// transfer patterns of a frame, as issued to the bus:
+//  - bytewise: one transfer per byte, the ioLibrary without burst callbacks
+//  - burst: the address and control phase, then the data phase, the ioLibrary burst callbacks
+//  - framed: address, control and data phase in one transfer, as SpiBus sends a register write
+static void write_bytewise(Bus& bus, const uint8_t* head, const uint8_t* data, uint16_t len) {
+    bus.select();
+    for (int i = 0; i < 3; ++i) bus.write(head + i, 1);
+    for (uint16_t i = 0; i < len; ++i) bus.write(data + i, 1);
+    bus.deselect();
+}
+
+static void write_burst(Bus& bus, const uint8_t* head, const uint8_t* data, uint16_t len) {
+    bus.select();
+    bus.write(head, 3);
+    bus.write(data, len);
+    bus.deselect();
+}
+
+static void write_framed(Bus& bus, const uint8_t* head, const uint8_t* data, uint16_t len) {
+    uint8_t frame[3 + 2048];
+    std::memcpy(frame, head, 3);
+    std::memcpy(frame + 3, data, len);
+    bus.select();
+    bus.write(frame, 3 + len);
+    bus.deselect();
+}
+
+static void read_bytewise(Bus& bus, const uint8_t* head, uint8_t* data, uint16_t len) {
+    bus.select();
+    for (int i = 0; i < 3; ++i) bus.write(head + i, 1);
+    for (uint16_t i = 0; i < len; ++i) bus.read(data + i, 1);
+    bus.deselect();
+}
+
+static void read_burst(Bus& bus, const uint8_t* head, uint8_t* data, uint16_t len) {
+    bus.select();
+    bus.write(head, 3);
+    bus.read(data, len);
+    bus.deselect();
+}
+
+int main() {
+    // 20 MHz SPI, and 2 us to set up a polled HAL transfer
+    auto sim = simulator::W5500({.spi_clock=20'000'000, .transfer_ns=2'000});
+    auto chip = Chip{sim};
+
+    const uint8_t tx_head[3] = {0x00, 0x00, uint8_t(Chip::tx(0) << 3 | 0x04)};
+    const uint8_t sr_head[3] = {0x00, Chip::Sn_SR, uint8_t(Chip::regs(0) << 3)};
+    uint8_t data[2048];
+    std::memset(data, 0x5A, sizeof(data));
+
+    struct Writer {
+        const char* name;
+        void (*write)(Bus&, const uint8_t*, const uint8_t*, uint16_t);
+        uint32_t transfers;     ///< expected for a 2 KB buffer write.
+    };
+    const Writer writers[] = {
+        {"2 KB TX buffer write, bytewise", write_bytewise, 3 + 2048},
+        {"2 KB TX buffer write, burst", write_burst, 2},
+        {"2 KB TX buffer write, framed", write_framed, 1},
+    };
+
+    double ns[3];
+    for (int i = 0; i < 3; ++i) {
+        sim.stats = {};
+        ns[i] = bench(writers[i].name, 20, [&] { writers[i].write(sim, tx_head, data, sizeof(data)); });
+        CHECK(sim.stats.transfers == 20 * writers[i].transfers);
+        CHECK(sim.stats.bytes == 20 * (3 + sizeof(data)));
+        std::printf("%-40s %12.2f MB/s\n", "", sizeof(data) / ns[i] * 1e3);
+    }
+    CHECK(ns[1] < ns[0]);
+
+    uint8_t check[16];
+    chip.read(0, Chip::tx(0), check, sizeof(check));
+    CHECK(std::memcmp(check, data, sizeof(check)) == 0);
+
+    uint8_t sr;
+    sim.stats = {};
+    auto bytewise = bench("Sn_SR read, bytewise", 1000, [&] { read_bytewise(sim, sr_head, &sr, 1); });
+    CHECK(sim.stats.transfers == 1000 * 4);
+    sim.stats = {};
+    auto burst = bench("Sn_SR read, burst", 1000, [&] { read_burst(sim, sr_head, &sr, 1); });
+    CHECK(sim.stats.transfers == 1000 * 2);
+    CHECK(burst < bytewise);
+
+    return result();
+}
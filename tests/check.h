@@ -0,0 +1,42 @@
+#ifndef WIZCHIP_TESTS_CHECK_H
+#define WIZCHIP_TESTS_CHECK_H
+
+#include <chrono>
+#include <cstdio>
+
+/// a failed check is reported and fails the test, the test goes on with the next one
+#define CHECK(cond) \
+    do { \
+        if (not (cond)) { \
+            std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            Project::wizchip::test::failures++; \
+        } \
+    } while (0)
+
+namespace Project::wizchip::test {
+    inline int failures = 0;
+
+    /// exit code of the test
+    inline int result() {
+        if (failures > 0) std::fprintf(stderr, "%d checks failed\n", failures);
+        return failures > 0 ? 1 : 0;
+    }
+
+    /// runs fn n times and prints the mean time of one run, returns it in ns
+    template <typename F>
+    double bench(const char* name, int n, F&& fn) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) fn();
+        auto ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / n;
+        std::printf("%-40s %12.1f ns\n", name, ns);
+        return ns;
+    }
+
+    /// keeps the compiler from dropping a result that is only measured
+    template <typename T>
+    void keep(T&& value) {
+        asm volatile("" : : "g"(&value) : "memory");
+    }
+}
+
+#endif // WIZCHIP_TESTS_CHECK_H
@@ -0,0 +1,110 @@
+#ifndef WIZCHIP_TESTS_CHIP_H
+#define WIZCHIP_TESTS_CHIP_H
+
+#include "wizchip/bus.h"
+
+namespace Project::wizchip::test {
+    /// register access in W5500 frames, as the ioLibrary does it, without the library
+    struct Chip {
+        // common registers
+        static constexpr uint16_t SIR = 0x0017;
+        static constexpr uint16_t SIMR = 0x0018;
+        static constexpr uint8_t common = 0;
+
+        // socket registers
+        static constexpr uint16_t Sn_MR = 0x00;
+        static constexpr uint16_t Sn_CR = 0x01;
+        static constexpr uint16_t Sn_IR = 0x02;
+        static constexpr uint16_t Sn_SR = 0x03;
+        static constexpr uint16_t Sn_PORT = 0x04;
+        static constexpr uint16_t Sn_DIPR = 0x0C;
+        static constexpr uint16_t Sn_DPORT = 0x10;
+        static constexpr uint16_t Sn_TX_FSR = 0x20;
+        static constexpr uint16_t Sn_TX_WR = 0x24;
+        static constexpr uint16_t Sn_RX_RSR = 0x26;
+        static constexpr uint16_t Sn_RX_RD = 0x28;
+        static constexpr uint16_t Sn_IMR = 0x2C;
+
+        static constexpr uint8_t OPEN = 0x01, LISTEN = 0x02, CONNECT = 0x04, DISCON = 0x08, CLOSE = 0x10, SEND = 0x20, RECV = 0x40;
+        static constexpr uint8_t IR_CON = 0x01, IR_DISCON = 0x02, IR_RECV = 0x04, IR_TIMEOUT = 0x08, IR_SENDOK = 0x10;
+        static constexpr uint8_t SOCK_CLOSED = 0x00, SOCK_INIT = 0x13, SOCK_LISTEN = 0x14, SOCK_ESTABLISHED = 0x17;
+        static constexpr uint8_t SOCK_CLOSE_WAIT = 0x1C, SOCK_UDP = 0x22;
+
+        /// block select of the registers, TX buffer and RX buffer of a socket
+        static constexpr uint8_t regs(int sn) { return uint8_t(sn * 4 + 1); }
+        static constexpr uint8_t tx(int sn) { return uint8_t(sn * 4 + 2); }
+        static constexpr uint8_t rx(int sn) { return uint8_t(sn * 4 + 3); }
+
+        Bus& bus;
+
+        void write(uint16_t address, uint8_t block, const uint8_t* data, uint16_t len) {
+            uint8_t head[3] = {uint8_t(address >> 8), uint8_t(address), uint8_t(block << 3 | 0x04)};
+            bus.select();
+            bus.write(head, 3);
+            bus.write(data, len);
+            bus.deselect();
+        }
+
+        void read(uint16_t address, uint8_t block, uint8_t* data, uint16_t len) {
+            uint8_t head[3] = {uint8_t(address >> 8), uint8_t(address), uint8_t(block << 3)};
+            bus.select();
+            bus.write(head, 3);
+            bus.read(data, len);
+            bus.deselect();
+        }
+
+        uint8_t read8(uint16_t address, uint8_t block) {
+            uint8_t value;
+            read(address, block, &value, 1);
+            return value;
+        }
+
+        void write8(uint16_t address, uint8_t block, uint8_t value) {
+            write(address, block, &value, 1);
+        }
+
+        uint16_t read16(uint16_t address, uint8_t block) {
+            uint8_t value[2];
+            read(address, block, value, 2);
+            return uint16_t(value[0] << 8 | value[1]);
+        }
+
+        void write16(uint16_t address, uint8_t block, uint16_t value) {
+            uint8_t bytes[2] = {uint8_t(value >> 8), uint8_t(value)};
+            write(address, block, bytes, 2);
+        }
+
+        void command(int sn, uint8_t cr) { write8(Sn_CR, regs(sn), cr); }
+        uint8_t status(int sn) { return read8(Sn_SR, regs(sn)); }
+
+        /// read and clear the interrupt bits of a socket
+        uint8_t interrupts(int sn) {
+            auto ir = read8(Sn_IR, regs(sn));
+            if (ir) write8(Sn_IR, regs(sn), ir);
+            return ir;
+        }
+
+        /// write into the TX buffer and SEND it
+        void send(int sn, const uint8_t* data, uint16_t len) {
+            auto wr = read16(Sn_TX_WR, regs(sn));
+            write(wr, tx(sn), data, len);
+            write16(Sn_TX_WR, regs(sn), uint16_t(wr + len));
+            command(sn, SEND);
+        }
+
+        /// read what the RX buffer holds, up to len, and RECV it
+        uint16_t receive(int sn, uint8_t* data, uint16_t len) {
+            auto n = read16(Sn_RX_RSR, regs(sn));
+            if (n > len) n = len;
+            if (n == 0) return 0;
+
+            auto rd = read16(Sn_RX_RD, regs(sn));
+            read(rd, rx(sn), data, n);
+            write16(Sn_RX_RD, regs(sn), uint16_t(rd + n));
+            command(sn, RECV);
+            return n;
+        }
+    };
+}
+
+#endif // WIZCHIP_TESTS_CHIP_H
@@ -0,0 +1,179 @@
+#include "wizchip/dns.h"
+#include "tests/host.h"
+#include "etl/async.h"
+#include "etl/keywords.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+namespace {
+    /// DNS server on the host loopback. "missing.test" does not exist, "slow.test" is answered after 100 ms,
+    /// any other name gets 10.0.0.1 with a TTL of ttl seconds
+    class Resolver {
+    public:
+        std::atomic<uint32_t> ttl = 60;
+
+        Resolver() {
+            fd = ::socket(AF_INET, SOCK_DGRAM, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(dns_port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) std::abort();
+            thread = std::thread([this] { serve(); });
+        }
+
+        ~Resolver() {
+            running = false;
+            thread.join();
+            ::close(fd);
+        }
+
+        /// queries received for the name
+        int queries(const std::string& name) {
+            auto lock = std::lock_guard(mutex);
+            return counts[name];
+        }
+
+    private:
+        void serve() {
+            uint8_t buf[512];
+            while (running) {
+                pollfd p = {fd, POLLIN, 0};
+                if (::poll(&p, 1, 10) <= 0) continue;
+
+                sockaddr_in from = {};
+                socklen_t from_len = sizeof(from);
+                auto n = ::recvfrom(fd, buf, sizeof(buf), 0, reinterpret_cast<sockaddr*>(&from), &from_len);
+                if (n <= 12) continue;
+
+                // the question name, label by label
+                std::string name;
+                size_t i = 12;
+                while (i < size_t(n) && buf[i] != 0) {
+                    if (not name.empty()) name += '.';
+                    name.append(reinterpret_cast<const char*>(buf + i + 1), buf[i]);
+                    i += buf[i] + 1;
+                }
+                size_t question_end = i + 5;
+                {
+                    auto lock = std::lock_guard(mutex);
+                    counts[name]++;
+                }
+                if (name == "slow.test") std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+                auto res = std::vector<uint8_t>(buf, buf + question_end);
+                res[2] = 0x81;
+                res[3] = name == "missing.test" ? 0x83 : 0x80;
+                if (name != "missing.test") {
+                    uint32_t t = ttl;
+                    res[7] = 1;
+                    uint8_t answer[] = {0xC0, 0x0C, 0, 1, 0, 1, uint8_t(t >> 24), uint8_t(t >> 16), uint8_t(t >> 8), uint8_t(t), 0, 4, 10, 0, 0, 1};
+                    res.insert(res.end(), answer, answer + sizeof(answer));
+                }
+                ::sendto(fd, res.data(), res.size(), 0, reinterpret_cast<sockaddr*>(&from), from_len);
+            }
+        }
+
+        int fd = -1;
+        std::atomic<bool> running = true;
+        std::thread thread;
+        std::mutex mutex;
+        std::map<std::string, int> counts;
+    };
+}
+
+static bool resolves(dns::Cache& cache, const std::string& name) {
+    auto res = cache.get_ip(name).wait(1000ms);
+    return res.is_ok() && res.unwrap().len() == 4 && res.unwrap()[0] == 10 && res.unwrap()[3] == 1;
+}
+
+// an answer is kept for the TTL of its record
+static void ttl(Resolver& resolver) {
+    auto cache = dns::Cache();
+    resolver.ttl = 1;
+    CHECK(resolves(cache, "known.test"));
+    CHECK(resolves(cache, "known.test"));
+    CHECK(resolver.queries("known.test") == 1);
+    CHECK(cache.stats().hits == 1 && cache.stats().misses == 1);
+
+    etl::this_thread::sleep(1100ms);
+    CHECK(resolves(cache, "known.test"));
+    CHECK(resolver.queries("known.test") == 2);
+    resolver.ttl = 60;
+}
+
+// a nonexistent domain is remembered for negative_ttl_ms
+static void negative(Resolver& resolver) {
+    auto cache = dns::Cache();
+    cache.negative_ttl_ms = 100;
+    auto res = cache.get_ip("missing.test").wait(1000ms);
+    CHECK(res.is_err() && res.unwrap_err() == osErrorParameter);
+    res = cache.get_ip("missing.test").wait(1000ms);
+    CHECK(res.is_err() && res.unwrap_err() == osErrorParameter);
+    CHECK(resolver.queries("missing.test") == 1);
+
+    etl::this_thread::sleep(150ms);
+    CHECK(cache.get_ip("missing.test").wait(1000ms).is_err());
+    CHECK(resolver.queries("missing.test") == 2);
+}
+
+// a full cache drops the least recently used entry
+static void lru(Resolver& resolver) {
+    auto cache = dns::Cache();
+    auto name = [](size_t i) { return "d" + std::to_string(i) + ".test"; };
+    for (size_t i = 0; i < dns::Cache::capacity; ++i) {
+        CHECK(resolves(cache, name(i)));
+        etl::this_thread::sleep(2ms);
+    }
+    CHECK(resolves(cache, name(0)));
+    etl::this_thread::sleep(2ms);
+
+    CHECK(resolves(cache, name(dns::Cache::capacity)));
+    CHECK(cache.stats().evicted == 1);
+
+    CHECK(resolves(cache, name(0)));
+    CHECK(resolver.queries(name(0)) == 1);
+    CHECK(resolves(cache, name(1)));
+    CHECK(resolver.queries(name(1)) == 2);
+}
+
+// two callers resolving the same domain at the same time share one query, the second one blocked until it is answered
+static void shared(Resolver& resolver) {
+    auto cache = dns::Cache();
+    std::atomic<int> other = -1;
+    auto started = etl::async([&cache, &other] {
+        etl::this_thread::sleep(20ms);
+        other = resolves(cache, "slow.test") ? 1 : 0;
+    });
+    CHECK(started.valid());
+
+    CHECK(resolves(cache, "slow.test"));
+    for (int i = 0; i < 100 && other < 0; ++i) etl::this_thread::sleep(10ms);
+
+    CHECK(other == 1);
+    CHECK(resolver.queries("slow.test") == 1);
+    CHECK(cache.stats().misses == 1 && cache.stats().shared == 1);
+}
+
+int main() {
+    return run_on_chip([] {
+        auto resolver = Resolver();
+        ttl(resolver);
+        negative(resolver);
+        lru(resolver);
+        shared(resolver);
+    });
+}
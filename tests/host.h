@@ -0,0 +1,68 @@
+#ifndef WIZCHIP_TESTS_HOST_H
+#define WIZCHIP_TESTS_HOST_H
+
+#include "wizchip/ethernet.h"
+#include "simulator/w5500.h"
+#include "tests/check.h"
+#include "etl/this_thread.h"
+#include <cstdlib>
+#include <functional>
+
+namespace Project::wizchip::test {
+    /// the library on a simulated chip in interrupt mode. Sessions reach the loopback at their port,
+    /// DNS queries at dns_port, and a server on port p listens on the loopback at p + 22000
+    constexpr uint16_t dns_port = 15353;
+
+    inline simulator::W5500& chip() {
+        static simulator::W5500 sim({
+            .port_offset=22000,
+            .route=[](const uint8_t*, uint16_t port) { return simulator::W5500::Remote{"127.0.0.1", port == 53 ? dns_port : port}; },
+        });
+        return sim;
+    }
+
+    inline Ethernet& ethernet() {
+        static Ethernet eth({
+            .netInfo={
+                .mac={0x00, 0x08, 0xdc, 0x00, 0xab, 0xcd},
+                .ip={192, 168, 0, 2},
+                .sn={255, 255, 255, 0},
+                .gw={192, 168, 0, 1},
+                .dns={192, 168, 0, 1},
+                .dhcp=NETINFO_STATIC,
+            },
+            .interrupt=true,
+            .bus=&chip(),
+        });
+        return eth;
+    }
+
+    /// runs fn on an RTOS thread once the chip is up, then exits with the result of the checks.
+    /// Library calls are made from RTOS threads only, host peers may run on std::thread
+    inline int run_on_chip(std::function<void()> fn) {
+        static auto body = etl::move(fn);
+
+        osKernelInitialize();
+
+        osThreadAttr_t attr = {};
+        attr.name = "test";
+        attr.stack_size = 16 * 1024;
+        osThreadNew([](void*) {
+            chip().on_interrupt = [] { ethernet().irq_handler(); };
+            chip().start();
+            ethernet().init();
+            while (not ethernet().isRunning()) etl::this_thread::sleep(1ms);
+
+            body();
+
+            ethernet().deinit();
+            chip().stop();
+            std::exit(result());
+        }, nullptr, &attr);
+
+        osKernelStart();
+        return result();
+    }
+}
+
+#endif // WIZCHIP_TESTS_HOST_H
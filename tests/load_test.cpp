@@ -0,0 +1,139 @@
+#include "wizchip/http/server.h"
+#include "tests/host.h"
+#include "tests/alloc_count.h"
+#include "etl/heap.h"
+#include "etl/keywords.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" void* pvPortMalloc(size_t size);
+extern "C" void vPortFree(void* ptr);
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+static http::Server app;
+
+static constexpr int connections = 2;
+static constexpr int requests_per_connection = 500;
+
+// keep-alive connection of a host client posting bodies and reading the echoes, false on the first wrong answer
+static bool post_all(const std::string& body) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(80 + 22000);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return false;
+    }
+
+    auto request = "POST /echo HTTP/1.1\r\nHost: 192.168.0.2\r\nContent-Type: text/plain\r\nAccept: */*\r\n"
+                   "User-Agent: load_test\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+    bool ok = true;
+    std::string in;
+    char buf[1024];
+    for (int i = 0; i < requests_per_connection && ok; ++i) {
+        ::send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+
+        // the head, then the body of its Content-Length
+        size_t end = std::string::npos, len = 0;
+        while (ok) {
+            if (end == std::string::npos && (end = in.find("\r\n\r\n")) != std::string::npos) {
+                auto cl = in.find("Content-Length: ");
+                len = cl < end ? std::atoi(in.c_str() + cl + 16) : 0;
+            }
+            if (end != std::string::npos && in.size() >= end + 4 + len) break;
+
+            auto n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n <= 0) ok = false;
+            else in.append(buf, n);
+        }
+        ok = ok && in.rfind("HTTP/1.1 200", 0) == 0 && in.substr(end + 4, len) == body;
+        if (ok) in.erase(0, end + 4 + len);
+    }
+
+    ::close(fd);
+    return ok;
+}
+
+// largest block the heap can give at once, a fragmented heap has it well below the free size
+static size_t largest_free_block() {
+    size_t lo = 0, hi = etl::heap::freeSize;
+    while (lo < hi) {
+        size_t mid = (lo + hi + 1) / 2;
+        if (auto ptr = pvPortMalloc(mid)) {
+            vPortFree(ptr);
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// sustained load on the server, the heap is sampled while it runs
+static void load(const char* name, size_t arena_size) {
+    app.arena_size = arena_size;
+    CHECK(app.start({.port=80, .number_of_socket=connections}).is_ok());
+    etl::this_thread::sleep(50ms);
+
+    auto body = std::string(300, 'x');
+    size_t free_before = etl::heap::freeSize;
+    size_t free_low = free_before;
+    size_t allocs_before = allocations;
+
+    std::atomic<int> done = 0;
+    std::atomic<int> failed = 0;
+    auto clients = std::vector<std::thread>();
+    for (int i = 0; i < connections; ++i) {
+        clients.emplace_back([&] {
+            if (not post_all(body)) failed++;
+            done++;
+        });
+    }
+    while (done < connections) {
+        free_low = std::min(free_low, size_t(etl::heap::freeSize));
+        etl::this_thread::sleep(1ms);
+    }
+    for (auto& client : clients) client.join();
+
+    double allocs = double(allocations - allocs_before) / (connections * requests_per_connection);
+    auto stats = app.memory_stats();
+    size_t free_after = etl::heap::freeSize;
+    size_t largest = largest_free_block();
+    app.stop();
+
+    std::printf("%s, %d requests\n", name, connections * requests_per_connection);
+    std::printf("  %-38s %12.2f\n", "heap allocations per request", allocs);
+    std::printf("  %-38s %12zu bytes\n", "heap high-water over the start", free_before - free_low);
+    std::printf("  %-38s %12zu bytes\n", "free heap after", free_after);
+    std::printf("  %-38s %12zu bytes\n", "largest free block after", largest);
+    std::printf("  %-38s %12.1f %%\n", "fragmentation", free_after ? 100.0 * (1.0 - double(largest) / free_after) : 0.0);
+    std::printf("  %-38s %12zu / %zu bytes, %u overflows\n", "arena high-water", stats.arena_high_water, stats.arena_size, stats.arena_overflows);
+
+    CHECK(failed == 0);
+}
+
+int main() {
+    app.Post("/echo", std::tuple{http::arg::body},
+    [](std::string_view body) -> etl::Result<std::string_view, http::Server::Error> {
+        return etl::Ok(body);
+    });
+
+    return run_on_chip([] {
+        // the arena is kept once a connection has one, so the run without it goes first
+        load("without the arena", 0);
+        load("with the arena", 2048);
+        CHECK(app.memory_stats().arena_overflows == 0);
+    });
+}
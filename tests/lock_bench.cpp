@@ -0,0 +1,95 @@
+#include "simulator/w5500.h"
+#include "tests/check.h"
+#include "tests/chip.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+/// waiters get the lock in arrival order, as an RTOS mutex hands it to the task waiting for it
+struct TicketLock {
+    std::atomic<uint32_t> next = 0;
+    std::atomic<uint32_t> serving = 0;
+
+    void lock() {
+        auto ticket = next++;
+        while (serving != ticket) std::this_thread::yield();
+    }
+
+    void unlock() { serving++; }
+};
+
+struct Latency {
+    double mean_us;
+    double p99_us;
+};
+
+// latency of a socket 1 status read while the event loop moves socket 0 buffers:
+//  - global: one lock held for the whole service of socket 0, the former Ethernet mutex
+//  - per transaction: the lock is held for one frame, the bus lock registered with reg_wizchip_cris_cbfunc
+static Latency status_latency(simulator::W5500& sim, bool global) {
+    auto chip = Chip{sim};
+    TicketLock lock;
+    std::atomic<bool> running = true;
+
+    std::thread service([&] {
+        uint8_t tx[2048], rx[1024];
+        std::memset(tx, 0x5A, sizeof(tx));
+        auto frame = [&](auto fn) {
+            if (not global) lock.lock();
+            fn();
+            if (not global) lock.unlock();
+        };
+
+        while (running) {
+            if (global) lock.lock();
+            frame([&] { keep(chip.read16(Chip::Sn_TX_FSR, Chip::regs(0))); });
+            frame([&] { chip.write(0, Chip::tx(0), tx, sizeof(tx)); });
+            frame([&] { chip.write16(Chip::Sn_TX_WR, Chip::regs(0), sizeof(tx)); });
+            frame([&] { keep(chip.read16(Chip::Sn_RX_RSR, Chip::regs(0))); });
+            frame([&] { chip.read(0, Chip::rx(0), rx, sizeof(rx)); });
+            frame([&] { chip.write16(Chip::Sn_RX_RD, Chip::regs(0), sizeof(rx)); });
+            if (global) lock.unlock();
+            std::this_thread::yield();
+        }
+    });
+
+    // a worker polling its own socket
+    std::vector<double> samples;
+    for (int i = 0; i < 400; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        lock.lock();
+        keep(chip.status(1));
+        lock.unlock();
+        samples.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+
+    running = false;
+    service.join();
+
+    std::sort(samples.begin(), samples.end());
+    double sum = 0;
+    for (auto sample : samples) sum += sample;
+    return {sum / samples.size(), samples[samples.size() * 99 / 100]};
+}
+
+int main() {
+    // 20 MHz SPI, and 2 us to set up a polled HAL transfer
+    auto sim = simulator::W5500({.spi_clock=20'000'000, .transfer_ns=2'000});
+
+    auto global = status_latency(sim, true);
+    std::printf("%-40s %9.1f us mean %9.1f us p99\n", "Sn_SR read, global lock", global.mean_us, global.p99_us);
+    auto per_transaction = status_latency(sim, false);
+    std::printf("%-40s %9.1f us mean %9.1f us p99\n", "Sn_SR read, lock per transaction", per_transaction.mean_us, per_transaction.p99_us);
+
+    // a read waits for at most one frame instead of the whole service of another socket
+    CHECK(per_transaction.mean_us < global.mean_us);
+
+    return result();
+}
@@ -0,0 +1,155 @@
+#include "wizchip/http/parser.h"
+#include "tests/check.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+static const std::string_view request = 
+    "POST /devices/12?verbose=1 HTTP/1.1\r\n"
+    "Host: 192.168.0.10\r\n"
+    "User-Agent: curl/8.4.0\r\n"
+    "Accept: */*\r\n"
+    "Content-Type: application/json\r\n"
+    "Content-Length: 17\r\n"
+    "\r\n"
+    "{\"on\":true,\"n\":1}";
+
+static auto bytes(std::string_view sv) -> const uint8_t* {
+    return reinterpret_cast<const uint8_t*>(sv.data());
+}
+
+/// feeds the head in pieces of at most step bytes, returns the bytes consumed
+static size_t parse(http::Parser& parser, std::string_view message, size_t step = SIZE_MAX) {
+    size_t consumed = 0;
+    while (consumed < message.size() && not parser.done() && not parser.failed()) {
+        auto len = std::min(step, message.size() - consumed);
+        consumed += parser.feed(bytes(message) + consumed, len);
+    }
+    return consumed;
+}
+
+static auto head(std::string_view fields) -> std::string {
+    return std::string("GET / HTTP/1.1\r\n") + std::string(fields) + "\r\n";
+}
+
+static void split_anywhere() {
+    auto body_start = request.find("\r\n\r\n") + 4;
+    for (size_t step = 1; step <= request.size(); ++step) {
+        auto parser = http::Parser();
+        auto consumed = parse(parser, request, step);
+        CHECK(parser.done());
+        CHECK(consumed == body_start);
+        CHECK(parser.body_start == body_start);
+        CHECK(parser.header_count == 5);
+        CHECK(parser.has_content_length && parser.content_length == 17);
+    }
+
+    // the head may also end with bare line feeds
+    auto parser = http::Parser();
+    parse(parser, "GET / HTTP/1.0\nContent-Length: 3\n\nabc");
+    CHECK(parser.done() && parser.content_length == 3 && parser.body_start == 34);
+}
+
+static void content_length() {
+    auto parser = http::Parser();
+    parse(parser, head("content-LENGTH:  42 \r\n"));
+    CHECK(parser.done() && parser.content_length == 42);
+
+    // largest value that fits, then one more
+    auto max = std::to_string(SIZE_MAX);
+    parser = http::Parser();
+    parse(parser, head("Content-Length: " + max + "\r\n"));
+    CHECK(parser.done() && parser.content_length == SIZE_MAX);
+
+    max.back()++;
+    parser = http::Parser();
+    parse(parser, head("Content-Length: " + max + "\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+
+    parser = http::Parser();
+    parse(parser, head("Content-Length: 18446744073709551616000\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+
+    parser = http::Parser();
+    parse(parser, head("Content-Length: 12a\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+
+    parser = http::Parser();
+    parse(parser, head("Content-Length: \r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+}
+
+static void repeated_content_length() {
+    auto parser = http::Parser();
+    parse(parser, head("Content-Length: 5\r\nContent-Length: 5\r\n"));
+    CHECK(parser.done() && parser.content_length == 5);
+
+    parser = http::Parser();
+    parse(parser, head("Content-Length: 5\r\nContent-Length: 0\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+
+    parser = http::Parser();
+    parse(parser, head("Content-Length: 0\r\nX-Other: 1\r\nContent-Length: 500\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+}
+
+static void chunked() {
+    auto parser = http::Parser();
+    parse(parser, head("Transfer-Encoding: gzip, chunked\r\n"));
+    CHECK(parser.done() && parser.chunked && not parser.has_content_length);
+
+    parser = http::Parser();
+    parse(parser, head("Content-Length: 5\r\nTransfer-Encoding: chunked\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+
+    parser = http::Parser();
+    parse(parser, head("Transfer-Encoding: chunked\r\nContent-Length: 5\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+
+    std::string body;
+    auto decoder = http::ChunkDecoder();
+    std::string_view chunks = "5;ext=1\r\nhello\r\n6\r\n world\r\n0\r\nTrailer: x\r\n\r\n";
+    auto consumed = decoder.feed(bytes(chunks), chunks.size(), [&body](const uint8_t* data, size_t len) {
+        body.append(reinterpret_cast<const char*>(data), len);
+        return true;
+    });
+    CHECK(decoder.done() && consumed == chunks.size() && body == "hello world");
+}
+
+static void limits() {
+    auto parser = http::Parser({.max_headers=2, .max_header_size=4096});
+    parse(parser, head("A: 1\r\nB: 2\r\nC: 3\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::TooManyHeaders);
+
+    parser = http::Parser({.max_headers=24, .max_header_size=32});
+    parse(parser, request);
+    CHECK(parser.failed() && parser.error == http::Parser::Error::HeaderTooLarge);
+
+    parser = http::Parser();
+    parse(parser, head("No colon here\r\n"));
+    CHECK(parser.failed() && parser.error == http::Parser::Error::Malformed);
+}
+
+int main() {
+    split_anywhere();
+    content_length();
+    repeated_content_length();
+    chunked();
+    limits();
+
+    auto parser = http::Parser();
+    bench("parse a request head in one piece", 100'000, [&] {
+        parser.reset();
+        keep(parser.feed(bytes(request), request.size()));
+    });
+    bench("parse a request head in 64 byte pieces", 100'000, [&] {
+        parser.reset();
+        keep(parse(parser, request, 64));
+    });
+
+    return result();
+}
@@ -0,0 +1,109 @@
+#ifndef WIZCHIP_TESTS_PEER_H
+#define WIZCHIP_TESTS_PEER_H
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+
+namespace Project::wizchip::test {
+    /// HTTP server on the host loopback, the far end of the library's client sessions.
+    /// Requests of a connection are answered in order, pipelined ones included, one connection at a time
+    class Peer {
+    public:
+        struct Reply {
+            std::string response;   ///< sent as is, nothing is sent when empty.
+            bool close = false;     ///< the connection is closed after the response.
+        };
+
+        /// answers a request head, the body is read and dropped
+        std::function<Reply(const std::string& head)> handler;
+
+        std::atomic<int> accepted = 0;      ///< connections accepted.
+        std::atomic<int> requests = 0;      ///< requests read.
+        std::atomic<int> reads = 0;         ///< reads that returned data, a batch sent at once takes few of them.
+        std::atomic<int> delay_ms = 0;      ///< waited before answering what one read brought, as a network round trip.
+
+        explicit Peer(uint16_t port) {
+            fd = ::socket(AF_INET, SOCK_STREAM, 0);
+            int one = 1;
+            ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, 8) < 0) std::abort();
+            thread = std::thread([this] { serve(); });
+        }
+
+        ~Peer() {
+            running = false;
+            thread.join();
+            ::close(fd);
+        }
+
+        /// closes the current connection without a word, as a server dropping an idle keep-alive connection
+        void drop() { dropping = true; }
+
+        static Reply ok(std::string body = "ok", std::string status = "200 OK") {
+            return {"HTTP/1.1 " + status + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body};
+        }
+
+    private:
+        void serve() {
+            while (running) {
+                pollfd p = {fd, POLLIN, 0};
+                if (::poll(&p, 1, 10) <= 0) continue;
+                int conn = ::accept(fd, nullptr, nullptr);
+                if (conn < 0) continue;
+                accepted++;
+                talk(conn);
+                ::close(conn);
+            }
+        }
+
+        void talk(int conn) {
+            std::string in;
+            char buf[1024];
+            while (running) {
+                if (dropping.exchange(false)) return;
+
+                pollfd p = {conn, POLLIN, 0};
+                if (::poll(&p, 1, 10) <= 0) continue;
+                auto n = ::recv(conn, buf, sizeof(buf), 0);
+                if (n <= 0) return;
+                reads++;
+                in.append(buf, n);
+                if (delay_ms > 0) std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms.load()));
+
+                // every complete request in what came so far
+                for (size_t end; (end = in.find("\r\n\r\n")) != std::string::npos;) {
+                    auto head = in.substr(0, end + 4);
+                    size_t body = 0;
+                    if (auto cl = head.find("Content-Length: "); cl != std::string::npos) body = std::atoi(head.c_str() + cl + 16);
+                    if (in.size() < head.size() + body) break;
+                    in.erase(0, head.size() + body);
+                    requests++;
+
+                    auto reply = handler ? handler(head) : ok();
+                    if (not reply.response.empty()) ::send(conn, reply.response.data(), reply.response.size(), MSG_NOSIGNAL);
+                    if (reply.close) return;
+                }
+            }
+        }
+
+        int fd = -1;
+        std::atomic<bool> running = true;
+        std::atomic<bool> dropping = false;
+        std::thread thread;
+    };
+}
+
+#endif // WIZCHIP_TESTS_PEER_H
@@ -0,0 +1,95 @@
+#include "wizchip/http/client.h"
+#include "tests/host.h"
+#include "tests/peer.h"
+#include "etl/keywords.h"
+#include <chrono>
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+static auto request(const char* method, const char* path) -> http::Request {
+    return {.method=method, .path=path, .version="HTTP/1.1"};
+}
+
+// a HEAD response and a 204 have no body, the responses after them are still matched to their requests
+static Peer::Reply answer(const std::string& head) {
+    auto path = head.substr(head.find(' ') + 1);
+    path = path.substr(0, path.find(' '));
+    if (head.rfind("HEAD ", 0) == 0) return {"HTTP/1.1 200 OK\r\nContent-Length: 5\r\n\r\n"};
+    if (path == "/empty") return {"HTTP/1.1 204 No Content\r\n\r\n"};
+    return Peer::ok(path.substr(1));
+}
+
+static void in_order(Peer& peer) {
+    auto client = http::Client("192.168.0.10:18081");
+    auto batch = std::vector<http::Request>();
+    batch.push_back(request("GET", "/a"));
+    batch.push_back(request("HEAD", "/h"));
+    batch.push_back(request("GET", "/b"));
+    batch.push_back(request("DELETE", "/empty"));
+    batch.push_back(request("GET", "/c"));
+
+    auto futures = client.pipeline(mv | batch);
+    auto a = futures[0].wait(1000ms);
+    auto h = futures[1].wait(1000ms);
+    auto b = futures[2].wait(1000ms);
+    auto empty = futures[3].wait(1000ms);
+    auto c = futures[4].wait(1000ms);
+
+    CHECK(a.is_ok() && a.unwrap().body == "a");
+    CHECK(h.is_ok() && h.unwrap().status == 200 && h.unwrap().body.empty());
+    CHECK(b.is_ok() && b.unwrap().body == "b");
+    CHECK(empty.is_ok() && empty.unwrap().status == 204 && empty.unwrap().body.empty());
+    CHECK(c.is_ok() && c.unwrap().body == "c");
+    CHECK(peer.requests == 5);
+
+    // waited for out of order, the earlier responses are kept for their futures
+    batch.clear();
+    batch.push_back(request("GET", "/x"));
+    batch.push_back(request("GET", "/y"));
+    futures = client.pipeline(mv | batch);
+    auto y = futures[1].wait(1000ms);
+    auto x = futures[0].wait(1000ms);
+    CHECK(x.is_ok() && x.unwrap().body == "x");
+    CHECK(y.is_ok() && y.unwrap().body == "y");
+}
+
+// n requests one after the other against one batch, each read of the peer costs a round trip
+static void round_trips(Peer& peer) {
+    constexpr int n = 8;
+    peer.delay_ms = 5;
+
+    auto measure = [&](const char* name, auto&& run) {
+        auto client = http::Client("192.168.0.10:18081");
+        peer.reads = 0;
+        auto start = std::chrono::steady_clock::now();
+        run(client);
+        auto ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::printf("%-40s %12.1f ms %6d round trips\n", name, ms, peer.reads.load());
+        return ms;
+    };
+
+    double one_by_one = measure("8 requests one by one", [&](http::Client& client) {
+        for (int i = 0; i < n; ++i) CHECK(client.Get("/r").wait(1000ms).is_ok());
+    });
+    CHECK(peer.reads == n);
+
+    double pipelined = measure("8 requests pipelined", [&](http::Client& client) {
+        auto batch = std::vector<http::Request>(n, request("GET", "/r"));
+        for (auto& res : client.pipeline(mv | batch)) CHECK(res.wait(1000ms).is_ok());
+    });
+    CHECK(peer.reads < n);
+    CHECK(pipelined < one_by_one);
+
+    peer.delay_ms = 0;
+}
+
+int main() {
+    return run_on_chip([] {
+        auto peer = Peer(18081);
+        peer.handler = answer;
+        in_order(peer);
+        round_trips(peer);
+    });
+}
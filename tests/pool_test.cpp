@@ -0,0 +1,111 @@
+#include "wizchip/http/connection_pool.h"
+#include "tests/host.h"
+#include "tests/peer.h"
+#include "etl/keywords.h"
+#include <atomic>
+#include <chrono>
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+static const char* const url = "http://192.168.0.10:18080/status";
+
+static auto get(http::ConnectionPool& pool, const char* method = "GET") -> etl::Result<http::Response, osStatus_t> {
+    return pool.request(method, url, {}).wait(1000ms);
+}
+
+// requests to the same host share one connection
+static void reuse(Peer& peer) {
+    auto pool = http::ConnectionPool();
+    for (int i = 0; i < 3; ++i) {
+        auto res = get(pool);
+        CHECK(res.is_ok() && res.unwrap().body == "ok");
+    }
+    CHECK(peer.accepted == 1);
+    CHECK(pool.stats().created == 1 && pool.stats().reused == 2);
+}
+
+// a connection the server closed while idle is evicted, the next request opens a new one
+static void server_close(Peer& peer) {
+    auto pool = http::ConnectionPool();
+    CHECK(get(pool).is_ok());
+    peer.drop();
+    etl::this_thread::sleep(100ms);
+
+    CHECK(get(pool).is_ok());
+    CHECK(peer.accepted == 2);
+    CHECK(pool.stats().created == 2 && pool.stats().evicted == 1 && pool.stats().retried == 0);
+}
+
+// closed after the request was sent and before any byte of the response: an idempotent request is sent again,
+// a POST is not
+static void closed_before_response(Peer& peer) {
+    auto pool = http::ConnectionPool();
+    CHECK(get(pool).is_ok());
+
+    std::atomic<bool> drop_next = true;
+    peer.handler = [&drop_next](const std::string&) {
+        if (drop_next.exchange(false)) return Peer::Reply{"", true};
+        return Peer::ok();
+    };
+    auto res = get(pool);
+    CHECK(res.is_ok() && res.unwrap().body == "ok");
+    CHECK(pool.stats().retried == 1);
+
+    drop_next = true;
+    CHECK(get(pool, "POST").is_err());
+    CHECK(pool.stats().retried == 1);
+    peer.handler = {};
+}
+
+// idle connections past idle_timeout_ms are closed
+static void idle_eviction(Peer& peer) {
+    auto pool = http::ConnectionPool();
+    pool.idle_timeout_ms = 100;
+    CHECK(get(pool).is_ok());
+    pool.evict();
+    CHECK(pool.stats().evicted == 0);
+
+    etl::this_thread::sleep(150ms);
+    pool.evict();
+    CHECK(pool.stats().evicted == 1);
+
+    CHECK(get(pool).is_ok());
+    CHECK(peer.accepted == 2 && pool.stats().created == 2);
+}
+
+// latency of a request and sockets opened, on a kept connection and on a new one each time
+static void churn(Peer& peer) {
+    constexpr int n = 50;
+    auto measure = [&](const char* name, size_t max_connections) {
+        auto pool = http::ConnectionPool();
+        pool.max_connections = max_connections;
+        peer.accepted = 0;
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i) CHECK(get(pool).is_ok());
+        auto us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / n;
+        std::printf("%-40s %12.1f us %6d connections\n", name, us, peer.accepted.load());
+        return us;
+    };
+
+    measure("request on a pooled connection", 2);
+    CHECK(peer.accepted == 1);
+    measure("request on its own connection", 0);
+    CHECK(peer.accepted == n);
+}
+
+int main() {
+    return run_on_chip([] {
+        auto peer = Peer(18080);
+        reuse(peer);
+        peer.accepted = 0;
+        server_close(peer);
+        peer.accepted = 0;
+        closed_before_response(peer);
+        peer.accepted = 0;
+        idle_eviction(peer);
+        churn(peer);
+    });
+}
@@ -0,0 +1,60 @@
+#include "wizchip/http/server.h"
+#include "tests/check.h"
+#include <string>
+#include <vector>
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+// reaches the route tree of the server
+struct Routes : http::Server {
+    auto find(std::string_view path) -> Router* {
+        std::string_view values[max_path_params];
+        return find_route(path, values);
+    }
+
+    auto allowed(std::string_view path) -> uint16_t {
+        uint16_t res = 0;
+        for (auto router = find(path); router; router = router->next) res |= router->methods;
+        return res;
+    }
+};
+
+static constexpr int route_count = 32;
+
+int main() {
+    auto app = Routes();
+    auto paths = std::vector<std::string>();
+    for (int i = 0; i < route_count; ++i) {
+        paths.push_back("/api/v1/resource" + std::to_string(i) + "/items");
+        app.Get(paths.back(), {}, []() {});
+    }
+    app.Get("/devices/{id}", std::tuple{http::arg::param("id")}, [](int) {});
+    app.Post("/devices/{id}", std::tuple{http::arg::param("id")}, [](int) {});
+    app.Delete("/devices/{id}/config", std::tuple{http::arg::param("id")}, [](int) {});
+
+    CHECK(app.find(paths.back()) != nullptr);
+    CHECK(app.find("/api/v1/resource7/other") == nullptr);
+    CHECK(app.find("/devices/12") != nullptr);
+    CHECK(app.find("/devices/12/config") != nullptr);
+
+    // a 405 lists every method of the routes on the path
+    CHECK(app.allowed("/devices/12") == (http::Server::MethodGet | http::Server::MethodPost));
+    CHECK(http::Server::allow_header(app.allowed("/devices/12")) == "GET, POST");
+    CHECK(http::Server::allow_header(http::Server::MethodGet | http::Server::MethodHead) == "GET, HEAD");
+    CHECK(http::Server::allow_header(http::Server::MethodPatch | http::Server::MethodDelete) == "DELETE, PATCH");
+
+    auto last = std::string_view(paths.back());
+    bench("route tree, last of 32 routes", 100'000, [&] { keep(app.find(last)); });
+    bench("route tree, path parameter", 100'000, [&] { keep(app.find("/devices/12/config")); });
+
+    // every route path compared in turn, how routes were dispatched before
+    bench("linear scan, last of 32 routes", 100'000, [&] {
+        const std::string* res = nullptr;
+        for (auto& path : paths) if (path == last) { res = &path; break; }
+        keep(res);
+    });
+
+    return result();
+}
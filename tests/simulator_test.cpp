@@ -0,0 +1,226 @@
+#include "simulator/w5500.h"
+#include "tests/check.h"
+#include "tests/chip.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+using namespace std::chrono_literals;
+
+static constexpr int port_offset = 21000;
+
+static int connect_to(uint16_t port, int rcvbuf = 0) {
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (rcvbuf > 0) ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port + port_offset);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/// polls cond every ms until it holds or timeout passes
+template <typename F>
+static bool wait_for(F&& cond, std::chrono::milliseconds timeout = 1000ms) {
+    auto until = std::chrono::steady_clock::now() + timeout;
+    while (not cond()) {
+        if (std::chrono::steady_clock::now() >= until) return false;
+        std::this_thread::sleep_for(1ms);
+    }
+    return true;
+}
+
+static void open_listen(Chip& chip, int sn, uint16_t port) {
+    chip.write8(Chip::Sn_MR, Chip::regs(sn), 0x01);
+    chip.write16(Chip::Sn_PORT, Chip::regs(sn), port);
+    chip.command(sn, Chip::OPEN);
+    CHECK(chip.status(sn) == Chip::SOCK_INIT);
+    chip.command(sn, Chip::LISTEN);
+    CHECK(chip.status(sn) == Chip::SOCK_LISTEN);
+}
+
+static void tcp_round_trip(Chip& chip) {
+    const int sn = 1;
+    open_listen(chip, sn, 80);
+
+    int peer = connect_to(80);
+    CHECK(peer >= 0);
+    CHECK(wait_for([&] { return chip.status(sn) == Chip::SOCK_ESTABLISHED; }));
+    CHECK(chip.interrupts(sn) & Chip::IR_CON);
+
+    ::send(peer, "hello", 5, 0);
+    CHECK(wait_for([&] { return chip.read16(Chip::Sn_RX_RSR, Chip::regs(sn)) == 5; }));
+
+    uint8_t buf[16] = {};
+    CHECK(chip.receive(sn, buf, sizeof(buf)) == 5);
+    CHECK(std::memcmp(buf, "hello", 5) == 0);
+    CHECK(chip.read16(Chip::Sn_RX_RSR, Chip::regs(sn)) == 0);
+
+    chip.send(sn, reinterpret_cast<const uint8_t*>("world"), 5);
+    CHECK(wait_for([&] { return chip.interrupts(sn) & Chip::IR_SENDOK; }));
+    CHECK(chip.read16(Chip::Sn_TX_FSR, Chip::regs(sn)) == 2048);
+
+    char received[16] = {};
+    CHECK(::recv(peer, received, sizeof(received), 0) == 5);
+    CHECK(std::memcmp(received, "world", 5) == 0);
+
+    ::close(peer);
+    CHECK(wait_for([&] { return chip.status(sn) == Chip::SOCK_CLOSE_WAIT; }));
+    chip.command(sn, Chip::CLOSE);
+    CHECK(chip.status(sn) == Chip::SOCK_CLOSED);
+}
+
+static void stalled_peer(Chip& chip) {
+    // a peer that never reads fills the host socket buffers, SEND must not hold the bus until it reads
+    const int sn = 2, other = 3;
+    open_listen(chip, sn, 81);
+    open_listen(chip, other, 82);
+
+    int peer = connect_to(81, 4096);
+    CHECK(peer >= 0);
+    CHECK(wait_for([&] { return chip.status(sn) == Chip::SOCK_ESTABLISHED; }));
+
+    uint8_t data[2048];
+    std::memset(data, 'x', sizeof(data));
+
+    size_t queued = 0;
+    bool stalled = false;
+    for (int i = 0; i < 10'000 && not stalled; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        chip.send(sn, data, sizeof(data));
+        CHECK(std::chrono::steady_clock::now() - start < 100ms);
+        queued += sizeof(data);
+        stalled = not wait_for([&] { return chip.interrupts(sn) & Chip::IR_SENDOK; }, 50ms);
+    }
+    CHECK(stalled);
+
+    // other sockets are still served while the SEND is in progress
+    auto start = std::chrono::steady_clock::now();
+    CHECK(chip.status(other) == Chip::SOCK_LISTEN);
+    CHECK(std::chrono::steady_clock::now() - start < 50ms);
+
+    int second = connect_to(82);
+    CHECK(second >= 0);
+    CHECK(wait_for([&] { return chip.status(other) == Chip::SOCK_ESTABLISHED; }));
+
+    // once the peer reads, the SEND completes and the TX buffer is free again
+    uint8_t sink[4096];
+    size_t drained = 0;
+    CHECK(wait_for([&] {
+        pollfd pfd = {peer, POLLIN, 0};
+        while (::poll(&pfd, 1, 0) == 1) {
+            auto n = ::recv(peer, sink, sizeof(sink), 0);
+            if (n <= 0) break;
+            drained += n;
+        }
+        return drained == queued;
+    }, 5000ms));
+    CHECK(wait_for([&] { return chip.interrupts(sn) & Chip::IR_SENDOK; }));
+    CHECK(chip.read16(Chip::Sn_TX_FSR, Chip::regs(sn)) == 2048);
+
+    ::close(peer);
+    ::close(second);
+    chip.command(sn, Chip::CLOSE);
+    chip.command(other, Chip::CLOSE);
+}
+
+static void udp_round_trip(Chip& chip) {
+    const int sn = 4;
+    chip.write8(Chip::Sn_MR, Chip::regs(sn), 0x02);
+    chip.write16(Chip::Sn_PORT, Chip::regs(sn), 5353);
+    chip.command(sn, Chip::OPEN);
+    CHECK(chip.status(sn) == Chip::SOCK_UDP);
+
+    int peer = ::socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(5353 + port_offset);
+    ::inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+    ::sendto(peer, "ping", 4, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+    // each datagram is stored behind a header of peer address, peer port and length
+    CHECK(wait_for([&] { return chip.read16(Chip::Sn_RX_RSR, Chip::regs(sn)) == 12; }));
+    uint8_t buf[12];
+    CHECK(chip.receive(sn, buf, sizeof(buf)) == 12);
+    CHECK((buf[6] << 8 | buf[7]) == 4);
+    CHECK(std::memcmp(buf + 8, "ping", 4) == 0);
+
+    ::close(peer);
+    chip.command(sn, Chip::CLOSE);
+}
+
+static void interrupts(simulator::W5500& sim, Chip& chip) {
+    // interrupt mode as Ethernet::execute() sets it up: every socket in SIMR, Sn_IMR at its reset value
+    const int sn = 5;
+    std::atomic<int> edges = 0;
+    sim.on_interrupt = [&edges] { edges++; };
+    for (int i = 0; i < 8; ++i) chip.interrupts(i);
+    chip.write8(Chip::SIMR, Chip::common, 0xFF);
+    open_listen(chip, sn, 83);
+    CHECK(sim.intn());
+
+    int peer = connect_to(83);
+    CHECK(peer >= 0);
+    CHECK(wait_for([&] { return edges == 1; }));
+    CHECK(not sim.intn());
+    CHECK(chip.read8(Chip::SIR, Chip::common) == 1 << sn);
+    CHECK(chip.interrupts(sn) == Chip::IR_CON);
+    CHECK(sim.intn());
+
+    // a RECV raises one edge, however much data comes before Sn_IR is cleared
+    ::send(peer, "one", 3, 0);
+    CHECK(wait_for([&] { return edges == 2; }));
+    ::send(peer, "two", 3, 0);
+    CHECK(wait_for([&] { return chip.read16(Chip::Sn_RX_RSR, Chip::regs(sn)) == 6; }));
+    CHECK(edges == 2);
+    CHECK(not sim.intn());
+    CHECK(chip.read8(Chip::Sn_IR, Chip::regs(sn)) == Chip::IR_RECV);
+
+    // clearing Sn_IR drops INTn, the bit leaves SIR with it
+    uint8_t buf[16];
+    CHECK(chip.receive(sn, buf, sizeof(buf)) == 6);
+    chip.write8(Chip::Sn_IR, Chip::regs(sn), Chip::IR_RECV);
+    CHECK(sim.intn());
+    CHECK(chip.read8(Chip::SIR, Chip::common) == 0);
+
+    // a masked Sn_IMR bit raises nothing, the data still arrives
+    chip.write8(Chip::Sn_IMR, Chip::regs(sn), uint8_t(~Chip::IR_RECV));
+    ::send(peer, "three", 5, 0);
+    CHECK(wait_for([&] { return chip.read16(Chip::Sn_RX_RSR, Chip::regs(sn)) == 5; }));
+    std::this_thread::sleep_for(20ms);
+    CHECK(edges == 2);
+    CHECK(sim.intn());
+    CHECK(chip.read8(Chip::Sn_IR, Chip::regs(sn)) == 0);
+
+    ::close(peer);
+    chip.write8(Chip::Sn_IMR, Chip::regs(sn), 0xFF);
+    chip.write8(Chip::SIMR, Chip::common, 0);
+    chip.command(sn, Chip::CLOSE);
+    sim.on_interrupt = {};
+}
+
+int main() {
+    auto sim = simulator::W5500({.port_offset=port_offset});
+    auto chip = Chip{sim};
+    sim.start();
+
+    tcp_round_trip(chip);
+    stalled_peer(chip);
+    udp_round_trip(chip);
+    interrupts(sim, chip);
+
+    sim.stop();
+    return result();
+}
@@ -0,0 +1,106 @@
+#include "wizchip/tcp/server.h"
+#include "wizchip/tcp/client.h"
+#include "Ethernet/socket.h"
+#include "tests/host.h"
+#include "etl/async.h"
+#include "etl/keywords.h"
+#include <chrono>
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+namespace {
+    class Echo : public tcp::Server {
+    protected:
+        Stream response(int, etl::Vector<uint8_t> data) override {
+            Stream s;
+            s << std::string(reinterpret_cast<const char*>(data.data()), data.len());
+            return s;
+        }
+    };
+
+    Echo server;
+
+    auto client() -> tcp::Client* {
+        return new tcp::Client({.host=detail::ipv4_to_bytes("192.168.0.10"), .port=9});
+    }
+
+    bool listening(int sn) {
+        for (int i = 0; i < 100; ++i) {
+            if (getSn_SR(sn) == SOCK_LISTEN) return true;
+            etl::this_thread::sleep(10ms);
+        }
+        return false;
+    }
+
+    auto now() {
+        return std::chrono::steady_clock::now();
+    }
+
+    auto ms_since(std::chrono::steady_clock::time_point start) -> int {
+        return int(std::chrono::duration_cast<std::chrono::milliseconds>(now() - start).count());
+    }
+}
+
+// by default a server keeps every socket, a session gives up after session_timeout_ms
+static void keeps_sockets() {
+    ethernet().session_timeout_ms = 50;
+    CHECK(server.start({.port=80, .number_of_socket=_WIZCHIP_SOCK_NUM_}).is_ok());
+    for (int sn = 0; sn < _WIZCHIP_SOCK_NUM_; ++sn) CHECK(listening(sn));
+
+    auto start = now();
+    auto session = client();
+    CHECK(session->socket_number == -1);
+    CHECK(ms_since(start) >= 50);
+    delete session;
+
+    server.stop();
+}
+
+// idle listening sockets above min_sockets are lent, and listen for the server again once released
+static void lends_sockets() {
+    ethernet().session_timeout_ms = 50;
+    CHECK(server.start({.port=80, .number_of_socket=_WIZCHIP_SOCK_NUM_, .min_sockets=_WIZCHIP_SOCK_NUM_ - 2}).is_ok());
+    for (int sn = 0; sn < _WIZCHIP_SOCK_NUM_; ++sn) CHECK(listening(sn));
+
+    auto a = client();
+    auto b = client();
+    auto c = client();
+    CHECK(a->socket_number >= 0 && b->socket_number >= 0 && a->socket_number != b->socket_number);
+    CHECK(c->socket_number == -1);
+    delete c;
+
+    int lent = a->socket_number;
+    CHECK(getSn_SR(lent) != SOCK_LISTEN);
+    delete a;
+    CHECK(listening(lent));
+
+    // a session waiting for a socket takes the one released meanwhile, before its timeout
+    a = client();
+    CHECK(a->socket_number >= 0);
+    ethernet().session_timeout_ms = 1000;
+    auto released = etl::async([b] {
+        etl::this_thread::sleep(100ms);
+        delete b;
+    });
+    CHECK(released.valid());
+
+    auto start = now();
+    auto waiting = client();
+    int waited = ms_since(start);
+    CHECK(waiting->socket_number >= 0);
+    CHECK(waited >= 90 && waited < 1000);
+    delete waiting;
+    delete a;
+
+    for (int sn = 0; sn < _WIZCHIP_SOCK_NUM_; ++sn) CHECK(listening(sn));
+    server.stop();
+}
+
+int main() {
+    return run_on_chip([] {
+        keeps_sockets();
+        lends_sockets();
+    });
+}
@@ -0,0 +1,143 @@
+#include "wizchip/stream.h"
+#include "wizchip/http/response.h"
+#include "tests/check.h"
+#include "tests/alloc_count.h"
+#include "etl/keywords.h"
+#include <cstring>
+
+using namespace Project;
+using namespace Project::wizchip;
+using namespace Project::wizchip::test;
+
+static auto bytes(const char* str) -> etl::Iter<const uint8_t*> {
+    auto ptr = reinterpret_cast<const uint8_t*>(str);
+    return etl::iter(ptr, ptr + std::strlen(str));
+}
+
+static auto drain(Stream& s) -> std::string {
+    std::string res;
+    s >> [&res](etl::Iter<const uint8_t*> data) { 
+        res.append(reinterpret_cast<const char*>(&(*data)), data.len()); 
+    };
+    return res;
+}
+
+static void order() {
+    static const char large[] = "a referenced piece longer than a small fragment";
+    auto s = Stream();
+    s << bytes("GET ") << bytes(large) << std::string(" owned") << std::string(300, 'x');
+    s << Stream::InRule([] { return bytes(" rule"); });
+
+    int n = 0;
+    s << Stream::Generator{[&n]() { return n++ < 3 ? bytes(" gen") : bytes(""); }};
+    s.write(" written", 8);
+
+    auto expected = std::string("GET ") + large + " owned" + std::string(300, 'x') + " rule gen gen gen written";
+    CHECK(drain(s) == expected);
+    CHECK(s.empty());
+}
+
+static void overflow() {
+    // past the fragment capacity and the arena everything goes on in order
+    static const char piece[] = "0123456789abcdefghij";
+    auto s = Stream();
+    auto expected = std::string();
+    for (size_t i = 0; i < Stream::fragment_capacity * 2; ++i) {
+        s << bytes(piece) << bytes(",");
+        expected += piece;
+        expected += ",";
+    }
+    CHECK(drain(s) == expected);
+}
+
+// response head as http::Response::dump() writes it
+static const char* const fields[][2] = {
+    {"Content-Type", "application/json"},
+    {"Content-Length", "128"},
+    {"Connection", "keep-alive"},
+    {"Server", "stm32-wizchip"},
+    {"Cache-Control", "no-cache"},
+    {"X-Response-Time", "3ms"},
+};
+
+static void build_head(Stream& s) {
+    s << bytes("HTTP/1.1 200 OK\r\n");
+    for (auto& field : fields) {
+        s << bytes(field[0]) << bytes(": ") << std::string(field[1]) << bytes("\r\n");
+    }
+    s << bytes("\r\n");
+}
+
+int main() {
+    order();
+    overflow();
+
+    uint8_t out[1024];
+    size_t out_len = 0;
+    auto copy_out = [&](etl::Iter<const uint8_t*> data) {
+        ::memcpy(out + out_len, &(*data), data.len());
+        out_len += data.len();
+    };
+
+    bench("response head, fragments and arena", 10'000, [&] {
+        auto s = Stream();
+        build_head(s);
+        out_len = 0;
+        s >> copy_out;
+        keep(out_len);
+    });
+
+    // every piece as its own lazy rule, how the stream was built before
+    bench("response head, one rule per piece", 10'000, [&] {
+        auto rules = etl::LinkedList<Stream::InRule>();
+        rules << Stream::InRule([] { return bytes("HTTP/1.1 200 OK\r\n"); });
+        for (auto& field : fields) {
+            rules << Stream::InRule([key=field[0]] { return bytes(key); });
+            rules << Stream::InRule([] { return bytes(": "); });
+            rules << Stream::InRule([value=std::string(field[1])] { 
+                auto ptr = reinterpret_cast<const uint8_t*>(value.data());
+                return etl::iter(ptr, ptr + value.size()); 
+            });
+            rules << Stream::InRule([] { return bytes("\r\n"); });
+        }
+        rules << Stream::InRule([] { return bytes("\r\n"); });
+
+        out_len = 0;
+        while (rules.len() > 0) {
+            copy_out(rules.front()());
+            rules.pop_front();
+        }
+        keep(out_len);
+    });
+
+    // the real head, allocations of one dump and send of it
+    auto res = http::Response {"HTTP/1.1", 200};
+    for (auto& field : fields) res.headers[field[0]] = field[1];
+
+    size_t allocs = count_allocations([&] {
+        bench("http::Response::dump()", 10'000, [&] {
+            out_len = 0;
+            res.dump() >> copy_out;
+            keep(out_len);
+        });
+    });
+    std::printf("%-40s %12.2f allocations\n", "", allocs / 10'000.0);
+    CHECK(allocs <= 10'000);
+
+    // against the fragments of the hand built head
+    allocs = count_allocations([&] {
+        auto s = Stream();
+        build_head(s);
+        out_len = 0;
+        s >> copy_out;
+    });
+    std::printf("%-40s %12zu allocations\n", "response head, fragments and arena", allocs);
+
+    auto s = Stream();
+    build_head(s);
+    auto head = drain(s);
+    CHECK(head.find("Content-Length: 128\r\n") != std::string::npos);
+    CHECK(head.size() > 4 && head.substr(head.size() - 4) == "\r\n\r\n");
+
+    return result();
+}
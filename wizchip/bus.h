@@ -0,0 +1,27 @@
+#ifndef WIZCHIP_BUS_H
+#define WIZCHIP_BUS_H
+
+#include <cstdint>
+
+namespace Project::wizchip {
+    /// Register access interface of the chip. 
+    /// A frame is select(), 3 bytes of address and control phase, the data phase, then deselect()
+    [[interface]]
+    class Bus {
+    public:
+        virtual ~Bus() = default;
+
+        virtual void select() = 0;
+        virtual void deselect() = 0;
+        virtual void read(uint8_t* buf, uint16_t len) = 0;
+        virtual void write(const uint8_t* buf, uint16_t len) = 0;
+
+        struct Stats {
+            uint32_t frames;        ///< number of select/deselect pairs
+            uint32_t transfers;     ///< number of transfers issued to the bus
+            uint32_t bytes;         ///< number of bytes clocked on the bus
+        } stats = {};
+    };
+}
+
+#endif // WIZCHIP_BUS_H
@@ -21,40 +21,187 @@ static auto make_query(const std::string& domain) -> Stream {
     };
 
     auto labels = etl::string_view(domain.c_str()).split<8>(".");
-    auto data = etl::vector_reserve<uint8_t>(labels.len() + domain.size());
 
+    Stream s;
+    s << etl::iter(start_bytes);
     for (auto label in labels) {
-        data.append(label.len());
-        for (auto ch in label) {
-            data.append(ch);
-        }
+        uint8_t len = label.len();
+        s.write(&len, 1);
+        s.write(label.data(), label.len());
     }
-
-    Stream s;
-    s << etl::iter(start_bytes) << [data=mv | data]() { return data.iter(); } << etl::iter(stop_bytes);
+    s << etl::iter(stop_bytes);
 
     return s;
 }
 
-static auto parse_data(const etl::Vector<uint8_t>& message) -> etl::Result<etl::Vector<uint8_t>, osStatus_t> {
+namespace {
+    struct Answer {
+        etl::Vector<uint8_t> ip;
+        uint32_t ttl;                   ///< seconds
+    };
+}
+
+static auto parse_data(const etl::Vector<uint8_t>& message) -> etl::Result<Answer, osStatus_t> {
+    // rcode 3, the name does not exist
+    if (message.len() >= 4 && (message[3] & 0x0F) == 3) {
+        return etl::Err(osErrorParameter);
+    }
+
     for (int i = 12; i < int(message.len()) - 13; ++i) {
         bool check = 
             message[i + 0] == 0 and message[i + 1] == 1 and // type 
             // message[i + 2] == 0 and message[i + 3] == 1 and // class
-            // message[i + 4] ... message[i + 7] // ttl
             message[i + 8] == 0 and message[i + 9] == 4; // length
 
         if (check) {
-            return etl::Ok(etl::vector(message[i + 10], message[i + 11], message[i + 12], message[i + 13]));
+            uint32_t ttl = uint32_t(message[i + 4]) << 24 | uint32_t(message[i + 5]) << 16 | 
+                           uint32_t(message[i + 6]) << 8 | uint32_t(message[i + 7]);
+            return etl::Ok(Answer{etl::vector(message[i + 10], message[i + 11], message[i + 12], message[i + 13]), ttl});
         }
     }
 
     return etl::Err(osErrorNoMemory);
 }
 
+auto dns::Cache::get_ip(std::string domain) -> etl::Future<etl::Vector<uint8_t>> {
+    return [this, domain=etl::move(domain)](etl::Time timeout) -> etl::Result<etl::Vector<uint8_t>, osStatus_t> {
+        auto start_time = etl::time::now();
+        bool waited = false;
+        Entry* entry = nullptr;
+
+        // a fresh entry answers, an outstanding query of another caller is waited for, otherwise this caller queries
+        while (true) {
+            uint32_t query = 0;
+            osSemaphoreId_t resolved = nullptr;
+            {
+                auto lock = mutex.lock().await();
+                auto now = etl::time::now().tick;
+                entry = find(domain);
+                if (entry && not entry->pending && int32_t(entry->expires - now) > 0) {
+                    entry->last_used = now;
+                    metrics.hits++;
+                    if (entry->negative) return etl::Err(osErrorParameter);
+                    return etl::Ok(etl::vector(entry->ip[0], entry->ip[1], entry->ip[2], entry->ip[3]));
+                }
+
+                if (not entry || not entry->pending) {
+                    // without a free slot the answer is not cached
+                    metrics.misses++;
+                    if (not entry) entry = slot();
+                    if (entry) {
+                        entry->domain = domain;
+                        entry->pending = true;
+                        entry->last_used = now;
+                        entry->query = ++queries;
+                        entry->waiters = 0;
+                    }
+                    break;
+                }
+
+                if (not waited) {
+                    metrics.shared++;
+                    waited = true;
+                }
+
+                if (entry->resolved == nullptr) entry->resolved = osSemaphoreNew(UINT16_MAX, 0, nullptr);
+                if (entry->resolved == nullptr || entry->waiters == UINT16_MAX) return etl::Err(osErrorResource);
+                entry->waiters++;
+                query = entry->query;
+                resolved = entry->resolved;
+            }
+
+            // blocked until the querying caller is done, then the entry is looked at again
+            uint32_t elapsed = etl::time::elapsed(start_time).tick;
+            if (elapsed < timeout.tick && osSemaphoreAcquire(resolved, timeout.tick - elapsed) == osOK) 
+                continue;
+
+            // still counted as a waiter unless the query finished meanwhile, its release is then taken back
+            auto lock = mutex.lock().await();
+            if (entry->pending && entry->query == query) {
+                entry->waiters--;
+            } else {
+                osSemaphoreAcquire(resolved, 0);
+            }
+            return etl::Err(osErrorTimeout);
+        }
+
+        auto res = udp::request(etl::vectorize<uint8_t>(Ethernet::self->getNetInfo().dns), 53, make_query(domain))
+            .and_then([](etl::Vector<uint8_t> received_data) {
+                return parse_data(received_data);
+            })
+            .wait(timeout);
+
+        auto lock = mutex.lock().await();
+        if (entry) {
+            auto now = etl::time::now().tick;
+            entry->pending = false;
+            if (res.is_ok()) {
+                auto& answer = res.unwrap();
+                ::memcpy(entry->ip, answer.ip.data(), sizeof(entry->ip));
+                entry->negative = false;
+                entry->expires = now + uint32_t(etl::min(uint64_t(answer.ttl) * 1000, uint64_t(max_ttl_ms)));
+            } else if (res.unwrap_err() == osErrorParameter) {
+                entry->negative = true;
+                entry->expires = now + negative_ttl_ms;
+            } else {
+                // a failed query is not remembered, the callers that waited for it query again
+                entry->domain.clear();
+            }
+
+            for (; entry->waiters > 0; entry->waiters--) {
+                osSemaphoreRelease(entry->resolved);
+            }
+        }
+
+        if (res.is_err()) {
+            return etl::Err(res.unwrap_err());
+        }
+        return etl::Ok(mv | res.unwrap().ip);
+    };
+}
+
+dns::Cache::~Cache() {
+    for (auto& entry : entries) {
+        if (entry.resolved) osSemaphoreDelete(entry.resolved);
+    }
+}
+
+void dns::Cache::flush() {
+    auto lock = mutex.lock().await();
+    for (auto& entry : entries) {
+        if (not entry.pending) entry.domain.clear();
+    }
+}
+
+auto dns::Cache::find(const std::string& domain) -> Entry* {
+    for (auto& entry : entries) {
+        if (not entry.domain.empty() && entry.domain == domain) return &entry;
+    }
+    return nullptr;
+}
+
+auto dns::Cache::slot() -> Entry* {
+    // an empty entry first, then an expired one, then the least recently used, never one being resolved
+    auto now = etl::time::now().tick;
+    Entry* expired = nullptr;
+    Entry* oldest = nullptr;
+    for (auto& entry : entries) {
+        if (entry.domain.empty()) return &entry;
+        if (entry.pending) continue;
+        if (not expired && int32_t(entry.expires - now) <= 0) expired = &entry;
+        if (not oldest || int32_t(entry.last_used - oldest->last_used) < 0) oldest = &entry;
+    }
+
+    if (expired) return expired;
+    if (oldest) metrics.evicted++;
+    return oldest;
+}
+
+auto dns::default_cache() -> Cache& {
+    static Cache cache;
+    return cache;
+}
+
 auto dns::get_ip(const std::string& domain) -> etl::Future<etl::Vector<uint8_t>> {
-    return udp::request(etl::vectorize<uint8_t>(Ethernet::self->getNetInfo().dns), 53, make_query(domain))
-        .and_then([](etl::Vector<uint8_t> received_data) {
-            return parse_data(received_data);
-        });
-}
\ No newline at end of file
+    return default_cache().get_ip(domain);
+}
@@ -3,10 +3,69 @@
 
 #include "etl/vector.h"
 #include "etl/future.h"
+#include "etl/mutex.h"
+#include "cmsis_os2.h"
 #include <string>
 
 namespace Project::wizchip::dns {
+    /// Addresses resolved by the DNS server, kept for the TTL of their record and keyed by domain.
+    /// A domain the server reports as nonexistent is remembered for negative_ttl_ms.
+    /// Concurrent lookups of the same domain share one query, the least recently used entry makes room for a new one
+    class Cache {
+    public:
+        static constexpr size_t capacity = 8;
+
+        struct Stats {
+            uint32_t hits;              ///< lookups answered from the cache, negative entries included.
+            uint32_t misses;            ///< lookups that sent a query.
+            uint32_t shared;            ///< lookups that waited for the query of another caller.
+            uint32_t evicted;           ///< unexpired entries dropped to make room.
+        };
+
+        Cache() { mutex.init(); }
+        ~Cache();
+
+        /// disable copy constructor and assignment
+        Cache(const Cache&) = delete;
+        Cache& operator=(const Cache&) = delete;
+
+        uint32_t negative_ttl_ms = 10'000;      ///< how long a nonexistent domain is remembered.
+        uint32_t max_ttl_ms = 3'600'000;        ///< cap on the record TTL.
+
+        /// cached address of the domain, or the answer of a query. Fails with osErrorParameter for a nonexistent domain
+        etl::Future<etl::Vector<uint8_t>> get_ip(std::string domain);
+
+        /// forget every entry except the ones being resolved
+        void flush();
+
+        Stats stats() const { return metrics; }
+
+    private:
+        struct Entry {
+            std::string domain;
+            uint8_t ip[4];
+            bool negative;              ///< the domain does not exist.
+            bool pending;               ///< a query is outstanding, the entry is not evicted.
+            uint32_t expires;           ///< tick at which the entry goes stale.
+            uint32_t last_used;
+            uint32_t query;             ///< number of the outstanding query, told apart from a later one on the same entry.
+            uint16_t waiters;           ///< callers waiting for the outstanding query.
+            osSemaphoreId_t resolved;   ///< released once per waiter when the query is done, made on the first wait.
+        };
+
+        Entry* find(const std::string& domain);
+        Entry* slot();
+
+        Entry entries[capacity] = {};
+        uint32_t queries = 0;
+        etl::Mutex mutex;
+        Stats metrics = {};
+    };
+
+    /// cache used by dns::get_ip()
+    Cache& default_cache();
+
     etl::Future<etl::Vector<uint8_t>> get_ip(const std::string& domain);
 } 
 
-#endif // WIZCHIP_DNS_H
\ No newline at end of file
+#endif // WIZCHIP_DNS_H
@@ -9,52 +9,102 @@ using namespace wizchip;
 Ethernet* Ethernet::self = nullptr;
 auto static f = etl::string<64>();
 
+static uint8_t buffer_kb(int kb);
+
+#ifndef WIZCHIP_HOST
+Ethernet::Ethernet(Args args) 
+    : spi_bus({.hspi=args.hspi, .cs=args.cs, .dma=args.dma})
+    , rst(args.rst)
+    , netInfo(args.netInfo)
+    , interrupt(args.interrupt)
+    , bus(args.bus ? args.bus : &spi_bus)
+    , memsize(args.memsize) {
+#else
+Ethernet::Ethernet(Args args) 
+    : netInfo(args.netInfo)
+    , interrupt(args.interrupt)
+    , bus(args.bus)
+    , memsize(args.memsize) {
+#endif
+    // the chip only takes 0, 1, 2, 4, 8 and 16 KB
+    int total = 0;
+    for (int i = 0; i < _WIZCHIP_SOCK_NUM_; ++i) {
+        memsize.tx[i] = buffer_kb(memsize.tx[i]);
+        memsize.rx[i] = buffer_kb(memsize.rx[i]);
+        total += memsize.tx[i] + memsize.rx[i];
+    }
+    if (total > 0) return;
+
+    for (auto& size : memsize.tx) size = 2;
+    for (auto& size : memsize.rx) size = 2;
+}
+
 void Ethernet::init() {
     self = this;
 
-    cs.init({.mode=GPIO_MODE_OUTPUT_OD});
+#ifndef WIZCHIP_HOST
     rst.init({.mode=GPIO_MODE_OUTPUT_OD});
-
-    cs.write(true);
     rst.write(true);
 
+    if (bus == &spi_bus) {
+        spi_bus.init();
+    }
+#endif
+
     reg_wizchip_cs_cbfunc(
-        [] { Ethernet::self->cs.write(false); }, 
-        [] { Ethernet::self->cs.write(true); }
+        [] { Ethernet::self->bus->select(); }, 
+        [] { Ethernet::self->bus->deselect(); }
     );
     reg_wizchip_spi_cbfunc(
         [] {
             uint8_t byte; 
-            HAL_SPI_Receive(&Ethernet::self->hspi, &byte, 1, HAL_MAX_DELAY); 
+            Ethernet::self->bus->read(&byte, 1); 
             return byte;
         }, 
         [] (uint8_t byte) { 
-            HAL_SPI_Transmit(&Ethernet::self->hspi, &byte, 1, HAL_MAX_DELAY); 
+            Ethernet::self->bus->write(&byte, 1); 
         }
     );
     reg_wizchip_spiburst_cbfunc(
         [] (uint8_t* buf, uint16_t len) { 
-            HAL_SPI_Receive(&Ethernet::self->hspi, buf, len, HAL_MAX_DELAY); 
+            Ethernet::self->bus->read(buf, len); 
         }, 
         [] (uint8_t* buf, uint16_t len) { 
-            HAL_SPI_Transmit(&Ethernet::self->hspi, buf, len, HAL_MAX_DELAY); 
+            Ethernet::self->bus->write(buf, len); 
         }
     );
 
+    // the chip driver enters the critical section around every register and buffer access, one SPI transaction each
+    static const osMutexAttr_t bus_mutex_attr = {.name="wizchip_bus", .attr_bits=osMutexRecursive | osMutexPrioInherit};
+    bus_mutex = osMutexNew(&bus_mutex_attr);
+    reg_wizchip_cris_cbfunc(
+        [] { osMutexAcquire(Ethernet::self->bus_mutex, osWaitForever); },
+        [] { osMutexRelease(Ethernet::self->bus_mutex); }
+    );
+
     mutex.init();
+    for (auto& m in socket_mutex) m.init();
+    socket_released = osSemaphoreNew(_WIZCHIP_SOCK_NUM_, 0, nullptr);
+    if (interrupt) {
+        irq_semaphore = osSemaphoreNew(1, 0, nullptr);
+    }
     etl::async(etl::bind<&Ethernet::execute>(this));
 }
 
 void Ethernet::execute() {
+#ifndef WIZCHIP_HOST
     rst.write(0);
     etl::this_thread::sleep(100ms);
     rst.write(1);
     etl::this_thread::sleep(100ms);
+#else
+    // without a reset pin the chip is reset through MR
+    wizchip_sw_reset();
+#endif
     
     logger << "ethernet start\n";
 
-    uint8_t memsize[2][8] = { {2,2,2,2,2,2,2,2}, {2,2,2,2,2,2,2,2} };
-    if (wizchip_init(memsize[0], memsize[1]) == -1) {
+    if (wizchip_init(memsize.tx, memsize.rx) == -1) {
         logger << "wizchip_init fail\n";
         return;
     }
@@ -70,52 +120,358 @@ void Ethernet::execute() {
     _is_running = true;
     setNetInfo(netInfo);
 
+    if (interrupt) {
+        // Sn_IMR is left at its reset value, masking a bit there also hides it from Sn_IR
+        intr_kind mask = IK_SOCK_ALL;
+        ctlwizchip(CW_SET_INTRMASK, &mask);
+        pending_sockets = 0xFF;
+    }
+
     while (_is_running) {
-        etl::this_thread::sleep(1ms);
-        
-        auto lock = mutex.lock().await();
-        for (auto socket_number : etl::range(_WIZCHIP_SOCK_NUM_)) {
-            auto &si = socket_handlers[socket_number].socket_interface;
-            if (si == nullptr)
+        bool sweep = true;
+        if (interrupt) {
+            // sleep until INTn is asserted, fall back to polling while some sockets are waiting for their state to settle
+            uint32_t timeout = pending_sockets ? 1 : idle_timeout_ms;
+            sweep = osSemaphoreAcquire(irq_semaphore, timeout) == osErrorTimeout && pending_sockets == 0;
+        } else {
+            etl::this_thread::sleep(1ms);
+        }
+
+
+        uint8_t flagged = 0xFF;
+        if (interrupt and not sweep) {
+            intr_kind ik;
+            ctlwizchip(CW_GET_INTERRUPT, &ik);
+            flagged = uint8_t(ik >> 8) | pending_sockets.exchange(0);
+        }
+
+        for (auto socket_number : etl::range(_WIZCHIP_SOCK_NUM_)) if (flagged & (1 << socket_number)) {
+            // a worker busy with another socket does not hold this one up
+            auto lock = socket_mutex[socket_number].lock().await();
+
+            if (interrupt) {
+                // interrupt clear, SENDOK is cleared by drain() which tracks the SEND in flight
+                auto ir = getSn_IR(socket_number) & (Sn_IR_RECV | Sn_IR_CON | Sn_IR_DISCON | Sn_IR_TIMEOUT);
+                if (ir) setSn_IR(socket_number, ir);
+            }
+
+            drain(socket_number);
+
+            if (socket_handlers[socket_number].socket_interface == nullptr)
                 continue;
 
-            switch (int res; getSn_SR(socket_number)) {
-                case SOCK_INIT:
-                    res = si->on_init(socket_number);
-                    logger << f("%d, %d: %s init\n", socket_number, res, si->kind());
-                    break;
-
-                case SOCK_LISTEN:
-                    res = si->on_listen(socket_number);
-                    logger << f("%d, %d: %s listen\n", socket_number, res, si->kind());
-                    break;
-
-                case SOCK_ESTABLISHED: 
-                    // Interrupt clear
-                    if (getSn_IR(socket_number) & Sn_IR_CON)
-                        setSn_IR(socket_number, Sn_IR_CON);
-                    res = si->on_established(socket_number);
-                    logger << f("%d, %d: %s established\n", socket_number, res, si->kind());
-                    break;
-
-                case SOCK_CLOSE_WAIT:
-                    res = si->on_close_wait(socket_number);
-                    logger << f("%d, %d: %s close wait\n", socket_number, res, si->kind());
-                    break;
-
-                case SOCK_FIN_WAIT:
-                case SOCK_CLOSED:
-                    res = si->on_closed(socket_number);
-                    logger << f("%d, %d: %s closed\n", socket_number, res, si->kind());
-                    break;
-
-                default:
-                    break;
+            service(socket_number);
+
+            if (interrupt) {
+                // states that are left without raising an interrupt have to be polled
+                switch (getSn_SR(socket_number)) {
+                    case SOCK_LISTEN: 
+                        break;
+                    case SOCK_ESTABLISHED:
+                    case SOCK_UDP:
+                        if (getSn_RX_RSR(socket_number) > 0) pending_sockets |= 1 << socket_number;
+                        break;
+                    default:
+                        pending_sockets |= 1 << socket_number;
+                        break;
+                }
             }
         }
 
-        check_phy_link();
+        if (interrupt) {
+            // INTn is edge triggered, bits that are still raised will not trigger another edge
+            intr_kind ik;
+            ctlwizchip(CW_GET_INTERRUPT, &ik);
+            pending_sockets |= uint8_t(ik >> 8);
+        }
+
+        if (sweep) check_phy_link();
+    }
+}
+
+void Ethernet::service(int socket_number) {
+    auto si = socket_handlers[socket_number].socket_interface;
+
+    switch (int res; getSn_SR(socket_number)) {
+        case SOCK_INIT:
+            res = si->on_init(socket_number);
+            logger << f("%d, %d: %s init\n", socket_number, res, si->kind());
+            break;
+
+        case SOCK_LISTEN:
+            res = si->on_listen(socket_number);
+            logger << f("%d, %d: %s listen\n", socket_number, res, si->kind());
+            break;
+
+        case SOCK_ESTABLISHED: 
+            // Interrupt clear
+            if (getSn_IR(socket_number) & Sn_IR_CON)
+                setSn_IR(socket_number, Sn_IR_CON);
+            res = si->on_established(socket_number);
+            logger << f("%d, %d: %s established\n", socket_number, res, si->kind());
+            break;
+
+        case SOCK_CLOSE_WAIT:
+            res = si->on_close_wait(socket_number);
+            logger << f("%d, %d: %s close wait\n", socket_number, res, si->kind());
+            break;
+
+        case SOCK_FIN_WAIT:
+        case SOCK_CLOSED:
+            res = si->on_closed(socket_number);
+            logger << f("%d, %d: %s closed\n", socket_number, res, si->kind());
+            break;
+
+        default:
+            break;
+    }
+}
+
+void Ethernet::drain(int socket_number) {
+    auto& q = tx_queues[socket_number];
+    auto fail = [&q](int err) {
+        q.err = err;
+        q.acked = q.tail = q.head.load();
+    };
+
+    // one SEND at a time, the next one waits for SENDOK
+    if (q.acked != q.tail) {
+        auto ir = getSn_IR(socket_number);
+        if (ir & Sn_IR_SENDOK) {
+            setSn_IR(socket_number, Sn_IR_SENDOK);
+            q.acked = q.tail.load();
+        } else if (ir & Sn_IR_TIMEOUT) {
+            setSn_IR(socket_number, Sn_IR_TIMEOUT);
+            return fail(SOCKERR_TIMEOUT);
+        } else if (getSn_SR(socket_number) == SOCK_CLOSED) {
+            return fail(SOCKERR_SOCKCLOSED);
+        } else {
+            return;
+        }
+    }
+
+    uint32_t queued = q.head - q.tail;
+    if (queued == 0) 
+        return;
+
+    auto status = getSn_SR(socket_number);
+    if (status != SOCK_ESTABLISHED && status != SOCK_CLOSE_WAIT) {
+        return fail(SOCKERR_SOCKSTATUS);
+    }
+
+    // everything the TX buffer takes goes out with a single SEND, the ring wraps around at most once
+    size_t n = etl::min(size_t(queued), size_t(getSn_TX_FSR(socket_number)));
+    if (n == 0) {
+        if (interrupt) pending_sockets |= 1 << socket_number;
+        return;
     }
+
+    size_t size = q.ring.len();
+    size_t offset = q.tail % size;
+    size_t first = etl::min(n, size - offset);
+    wiz_send_data(socket_number, q.ring.data() + offset, first);
+    if (n > first) wiz_send_data(socket_number, q.ring.data(), n - first);
+
+    setSn_CR(socket_number, Sn_CR_SEND);
+    while (getSn_CR(socket_number));
+    q.tail += n;
+
+    auto& stats = socket_stats[socket_number];
+    stats.tx_bytes += n;
+    stats.send_commands++;
+}
+
+auto Ethernet::send_queue(int socket_number) -> TxQueue& {
+    auto& q = tx_queues[socket_number];
+
+    // the ring is only replaced while nothing is queued, an idle queue also forgets the last error
+    if (q.head == q.acked) {
+        q.err = SOCK_OK;
+        if (q.ring.len() != tx_queue_size && etl::heap::freeSize >= tx_queue_size) {
+            q.ring = etl::vector_allocate<uint8_t>(tx_queue_size);
+        }
+    }
+    return q;
+}
+
+auto Ethernet::send(int socket_number, Stream& s) -> etl::Future<int> {
+    auto& q = send_queue(socket_number);
+    uint32_t start = q.head;
+
+    if (q.ring.len() == 0) {
+        return [](etl::Time) -> etl::Result<int, osStatus_t> { return etl::Ok(int(SOCKERR_BUFFER)); };
+    }
+
+    const size_t size = q.ring.len();
+    s >> [this, socket_number, &q, size](etl::Iter<const uint8_t*> data) {
+        auto ptr = &(*data);
+        size_t len = data.len();
+        while (len > 0 && q.err == SOCK_OK) {
+            // backpressure, the event loop frees the ring as the chip takes the bytes
+            size_t free = size - (q.head - q.tail);
+            if (free == 0) {
+                wake(socket_number);
+                etl::this_thread::sleep(1ms);
+                continue;
+            }
+
+            size_t offset = q.head % size;
+            auto n = etl::min(len, etl::min(free, size - offset));
+            ::memcpy(q.ring.data() + offset, ptr, n);
+            q.head += n;
+            ptr += n;
+            len -= n;
+        }
+    };
+    wake(socket_number);
+
+    uint32_t end = q.head;
+    return [this, socket_number, start, end](etl::Time timeout) -> etl::Result<int, osStatus_t> {
+        auto& q = tx_queues[socket_number];
+        auto start_time = etl::time::now();
+        while (int32_t(q.acked - end) < 0) {
+            if (q.err != SOCK_OK) return etl::Ok(q.err.load());
+            if (etl::time::elapsed(start_time) >= timeout) return etl::Err(osErrorTimeout);
+            etl::this_thread::sleep(1ms);
+        }
+        return etl::Ok(q.err != SOCK_OK ? q.err.load() : int(end - start));
+    };
+}
+
+bool Ethernet::try_send(int socket_number, Stream& s) {
+    auto& q = send_queue(socket_number);
+    const size_t size = q.ring.len();
+    if (size == 0 || q.err != SOCK_OK) 
+        return false;
+
+    // bytes past head are not seen by the event loop, they are published at once when the whole stream fits
+    uint32_t head = q.head;
+    bool fits = true;
+    s >> [&q, size, &head, &fits](etl::Iter<const uint8_t*> data) {
+        auto ptr = &(*data);
+        size_t len = data.len();
+        if (not fits || size - (head - q.tail) < len) {
+            fits = false;
+            return;
+        }
+        while (len > 0) {
+            size_t offset = head % size;
+            auto n = etl::min(len, size - offset);
+            ::memcpy(q.ring.data() + offset, ptr, n);
+            head += n;
+            ptr += n;
+            len -= n;
+        }
+    };
+    if (not fits) 
+        return false;
+
+    q.head = head;
+    wake(socket_number);
+    return true;
+}
+
+static constexpr int buffer_total_kb = _WIZCHIP_SOCK_NUM_ * 2;
+
+static uint8_t buffer_kb(int kb) {
+    if (kb <= 0) return 0;
+    uint8_t res = 1;
+    while (res < kb && res < 16) res <<= 1;
+    return res;
+}
+
+static int buffer_sum(const uint8_t (&sizes)[_WIZCHIP_SOCK_NUM_]) {
+    int res = 0;
+    for (auto size in sizes) res += size;
+    return res;
+}
+
+static void buffer_fit_traffic(uint8_t (&sizes)[_WIZCHIP_SOCK_NUM_], const uint32_t (&traffic)[_WIZCHIP_SOCK_NUM_]) {
+    // every socket keeps 1 KB, the rest is handed out by doubling the socket with the most traffic per KB
+    for (auto& size in sizes) size = 1;
+
+    for (int sum = buffer_sum(sizes);;) {
+        int best = -1;
+        for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) {
+            if (traffic[i] == 0 || sizes[i] == 16 || sum + sizes[i] > buffer_total_kb) 
+                continue;
+            if (best < 0 || traffic[i] / sizes[i] > traffic[best] / sizes[best]) 
+                best = i;
+        }
+        if (best < 0) break;
+
+        sum += sizes[best];
+        sizes[best] <<= 1;
+    }
+}
+
+auto Ethernet::buffer_profile() const -> Memsize {
+    uint32_t tx[_WIZCHIP_SOCK_NUM_], rx[_WIZCHIP_SOCK_NUM_];
+    uint32_t total = 0;
+    for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) {
+        tx[i] = socket_stats[i].tx_bytes;
+        rx[i] = socket_stats[i].rx_bytes;
+        total += tx[i] + rx[i];
+    }
+
+    if (total == 0) 
+        return memsize;
+
+    Memsize res;
+    buffer_fit_traffic(res.tx, tx);
+    buffer_fit_traffic(res.rx, rx);
+    return res;
+}
+
+template <typename F>
+static bool with_socket_locks(int first, F&& fn) {
+    if (first == _WIZCHIP_SOCK_NUM_) 
+        return fn();
+
+    auto lock = Ethernet::self->socket_mutex[first].lock().await();
+    return with_socket_locks(first + 1, etl::forward<F>(fn));
+}
+
+bool Ethernet::resize_buffers(const Memsize& sizes) {
+    if (buffer_sum(sizes.tx) > buffer_total_kb || buffer_sum(sizes.rx) > buffer_total_kb) 
+        return false;
+
+    if (not _is_running) {
+        memsize = sizes;
+        return true;
+    }
+
+    int first = 0;
+    while (first < _WIZCHIP_SOCK_NUM_ && sizes.tx[first] == memsize.tx[first] && sizes.rx[first] == memsize.rx[first]) 
+        first++;
+
+    // the chip lays the buffers out back to back, resizing a socket moves the buffers of every socket after it.
+    // Those sockets are locked in order, so the event loop does not reopen one of them meanwhile
+    return with_socket_locks(first, [&] {
+        for (int i = first; i < _WIZCHIP_SOCK_NUM_; ++i) {
+            if (getSn_SR(i) != SOCK_CLOSED) return false;
+        }
+
+        for (int i = first; i < _WIZCHIP_SOCK_NUM_; ++i) {
+            setSn_TXBUF_SIZE(i, sizes.tx[i]);
+            setSn_RXBUF_SIZE(i, sizes.rx[i]);
+        }
+
+        memsize = sizes;
+        return true;
+    });
+}
+
+void Ethernet::wake(int socket_number) {
+    if (not interrupt) 
+        return;
+
+    pending_sockets |= 1 << socket_number;
+    osSemaphoreRelease(irq_semaphore);
+}
+
+void Ethernet::irq_handler() {
+    if (irq_semaphore) osSemaphoreRelease(irq_semaphore);
 }
 
 void Ethernet::deinit() {
@@ -166,6 +522,8 @@ auto SocketServer::start(StartArgs args) -> etl::Result<void, osStatus_t> {
 
     auto lock = Ethernet::self->mutex.lock().await();
     port = args.port;
+    min_sockets = args.min_sockets < 0 ? args.number_of_socket : args.min_sockets;
+    lent = 0;
 
     if (etl::heap::freeSize < sizeof(int) * args.number_of_socket) {
         return etl::Err(osErrorNoMemory);
@@ -173,25 +531,88 @@ auto SocketServer::start(StartArgs args) -> etl::Result<void, osStatus_t> {
 
     reserved_sockets.reserve(args.number_of_socket);
 
+    // free sockets stay closed until they get a server, Ethernet::mutex keeps other starts and sessions off them
     int cnt = 0;
     for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) if (not Ethernet::self->socket_handlers[i].is_busy()) {
-        Ethernet::self->socket_handlers[i].socket_interface = this;
         reserved_sockets.append(i);
 
         cnt++;
         if (cnt == args.number_of_socket) break;
     }
 
+    // the layout is applied before the event loop sees the sockets, it would open them meanwhile.
+    // The server does not run with a layout it did not ask for
+    if ((args.tx_buffer_kb > 0 || args.rx_buffer_kb > 0) && not resize_buffers(args.tx_buffer_kb, args.rx_buffer_kb)) {
+        reserved_sockets.clear();
+        return etl::Err(osErrorResource);
+    }
+
+    for (auto sn in reserved_sockets) {
+        auto socket_lock = Ethernet::self->socket_mutex[sn].lock().await();
+        Ethernet::self->socket_handlers[sn].socket_interface = this;
+    }
+
+    for (auto sn in reserved_sockets) {
+        Ethernet::self->wake(sn);
+    }
+
     return etl::Ok();
 }
 
+bool SocketServer::resize_buffers(int tx_kb, int rx_kb) {
+    auto& ethernet = *Ethernet::self;
+    auto sizes = ethernet.memsize;
+    
+    uint8_t reserved = 0;
+    for (auto sn in reserved_sockets) {
+        reserved |= 1 << sn;
+        if (tx_kb > 0) sizes.tx[sn] = buffer_kb(tx_kb);
+        if (rx_kb > 0) sizes.rx[sn] = buffer_kb(rx_kb);
+    }
+
+    // make room by shrinking the largest buffers of the sockets nobody uses
+    auto fit = [&](uint8_t (&sizes)[_WIZCHIP_SOCK_NUM_]) {
+        while (buffer_sum(sizes) > buffer_total_kb) {
+            int largest = -1;
+            for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) {
+                if ((reserved & (1 << i)) || ethernet.socket_handlers[i].is_busy() || sizes[i] == 0) 
+                    continue;
+                if (largest < 0 || sizes[i] > sizes[largest]) 
+                    largest = i;
+            }
+            if (largest < 0) return false;
+            sizes[largest] >>= 1;
+        }
+        return true;
+    };
+
+    if (not fit(sizes.tx) || not fit(sizes.rx)) {
+        ethernet.logger << f("%s %d: not enough buffer memory\n", kind(), port);
+        return false;
+    } 
+    if (not ethernet.resize_buffers(sizes)) {
+        ethernet.logger << f("%s %d: buffer layout is locked by open sockets\n", kind(), port);
+        return false;
+    }
+    return true;
+}
+
 void SocketServer::stop() {
     auto lock = Ethernet::self->mutex.lock().await();
     for (auto sn in reserved_sockets) {
-        Ethernet::self->socket_handlers[sn].socket_interface = nullptr;
+        auto socket_lock = Ethernet::self->socket_mutex[sn].lock().await();
+        auto& handler = Ethernet::self->socket_handlers[sn];
+
+        // a lent socket stays with its session and is freed when released
+        if (handler.lent_from == this) {
+            handler.lent_from = nullptr;
+            continue;
+        }
+        handler.socket_interface = nullptr;
         ::close(sn);
     }
     reserved_sockets.clear();
+    lent = 0;
 }
 
 bool SocketServer::isRunning() const {
@@ -200,22 +621,92 @@ bool SocketServer::isRunning() const {
 
 static uint16_t port_session = 50000;
 
-SocketSession::SocketSession(uint8_t protocol, uint8_t flag, etl::Vector<uint8_t> host, int port) : host(etl::move(host)), port(port), socket_number(-1) {
-    auto lock = Ethernet::self->mutex.lock().await();
-    for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) if (not Ethernet::self->socket_handlers[i].is_busy()) {
-        Ethernet::self->socket_handlers[i].socket_session = true;
-        if (port_session == 0xFFFF) port_session = 50000; 
-        ::close(i);
-        ::socket(i, protocol, port_session++, flag);
-        socket_number = i;
+int Ethernet::acquire_socket(uint32_t timeout_ms) {
+    auto start_time = etl::time::now();
+    while (true) {
+        {
+            auto lock = mutex.lock().await();
+            for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) if (not socket_handlers[i].is_busy()) {
+                socket_handlers[i].socket_session = true;
+                return i;
+            }
+
+            // a listening socket has no connection to drop, the server gets it back on release
+            for (auto i in etl::range(_WIZCHIP_SOCK_NUM_)) {
+                auto& handler = socket_handlers[i];
+                auto server = handler.socket_interface;
+                if (server == nullptr || int(server->reserved_sockets.len()) - server->lent <= server->min_sockets) 
+                    continue;
+
+                auto socket_lock = socket_mutex[i].lock().await();
+                if (getSn_SR(i) != SOCK_LISTEN) 
+                    continue;
+
+                ::close(i);
+                handler.socket_interface = nullptr;
+                handler.socket_session = true;
+                handler.lent_from = server;
+                server->lent++;
+                logger << f("%d: lent by %s %d\n", i, server->kind(), server->port);
+                return i;
+            }
+        }
+
+        uint32_t elapsed = etl::time::elapsed(start_time).tick;
+        if (elapsed >= timeout_ms) 
+            return -1;
+
+        // woken by a released socket, or after a while to catch a server socket going back to listen
+        osSemaphoreAcquire(socket_released, etl::min(timeout_ms - elapsed, uint32_t(10)));
+    }
+}
+
+void Ethernet::release_socket(int socket_number) {
+    {
+        auto lock = mutex.lock().await();
+        auto socket_lock = socket_mutex[socket_number].lock().await();
+        auto& handler = socket_handlers[socket_number];
+        handler.socket_session = false;
+        ::close(socket_number);
+
+        // the event loop finds it closed and the server listens on it again
+        if (handler.lent_from) {
+            handler.lent_from->lent--;
+            handler.socket_interface = handler.lent_from;
+            handler.lent_from = nullptr;
+            wake(socket_number);
+        }
+    }
+
+    osSemaphoreRelease(socket_released);
+}
+
+SocketSession::SocketSession(uint8_t protocol, uint8_t flag, etl::Vector<uint8_t> host, int port) 
+    : host(etl::move(host))
+    , port(port)
+    , socket_number(Ethernet::self->acquire_socket(Ethernet::self->session_timeout_ms))
+    , protocol(protocol)
+    , flag(flag) {
+    if (socket_number < 0) {
+        Ethernet::self->logger << "no socket for session\n";
         return;
     }
+
+    reopen();
 }
 
-SocketSession::~SocketSession() {
+void SocketSession::reopen() {
     auto lock = Ethernet::self->mutex.lock().await();
-    Ethernet::self->socket_handlers[socket_number].socket_session = false;
+    auto socket_lock = Ethernet::self->socket_mutex[socket_number].lock().await();
+    if (port_session == 0xFFFF) port_session = 50000; 
     ::close(socket_number);
+    ::socket(socket_number, protocol, port_session++, flag);
+}
+
+SocketSession::~SocketSession() {
+    if (socket_number >= 0) {
+        Ethernet::self->release_socket(socket_number);
+    }
 }
 
 auto detail::ipv4_to_bytes(const char* ip) -> etl::Vector<uint8_t> {
@@ -243,18 +734,83 @@ auto detail::ipv4_port_to_pair(const char* ip_port) -> etl::Pair<etl::Vector<uin
     return {etl::move(ip), port};
 }
 
-void detail::tcp_receive_to(int socket_number, uint8_t* buf, size_t n) {
-    while (n > 0) {
-        auto len = ::getSn_RX_RSR(socket_number);
-        if (len == 0) {
-            etl::this_thread::sleep(10ms);
+size_t detail::tcp_receive_into(int socket_number, uint8_t* buf, size_t n) {
+    size_t len = etl::min(n, size_t(::getSn_RX_RSR(socket_number)));
+    if (len == 0) 
+        return 0;
+
+    auto res = ::recv(socket_number, buf, len);
+    if (res <= 0) 
+        return 0;
+
+    auto& stats = Ethernet::self->socket_stats[socket_number];
+    stats.rx_bytes += res;
+    stats.recv_commands++;
+    return res;
+}
+
+size_t detail::tcp_receive_to(int socket_number, uint8_t* buf, size_t n, uint32_t timeout_ms) {
+    auto start_time = etl::time::now();
+    size_t received = 0;
+    while (received < n) {
+        auto len = tcp_receive_into(socket_number, buf + received, n - received);
+        if (len > 0) {
+            received += len;
             continue;
         }
 
-        len = etl::min(n, len);
-        ::recv(socket_number, buf, len);
-        n -= len;
+        // nothing more comes once the peer has closed, what it sent before is already read
+        if (getSn_SR(socket_number) != SOCK_ESTABLISHED || etl::time::elapsed(start_time).tick >= timeout_ms) 
+            break;
+        etl::this_thread::sleep(10ms);
     }
+    return received;
+}
+
+int detail::tcp_send(int socket_number, const uint8_t* buf, size_t n) {
+    Stream s;
+    s << etl::iter(buf, buf + n);
+    return tcp_send(socket_number, s);
+}
+
+int detail::tcp_send(int socket_number, Stream& s) {
+    auto res = Ethernet::self->send(socket_number, s).await();
+    return res.is_ok() ? res.unwrap() : SOCKERR_TIMEOUT;
+}
+
+int detail::udp_send(int socket_number, const uint8_t* buf, size_t n, const uint8_t* ip, uint16_t port) {
+    auto res = ::sendto(socket_number, const_cast<uint8_t*>(buf), n, const_cast<uint8_t*>(ip), port);
+    if (res > 0) {
+        auto& stats = Ethernet::self->socket_stats[socket_number];
+        stats.tx_bytes += res;
+        stats.send_commands++;
+    }
+    return res;
+}
+
+// chunks a payload is gathered in when the RX buffer refills while it is read, allocated once and shared by every socket
+static constexpr size_t rx_chunk_count = 4;
+static constexpr size_t rx_chunk_size = 2048;
+static etl::Vector<uint8_t> rx_chunks[rx_chunk_count];
+static std::atomic<uint8_t> rx_chunks_taken = 0;
+
+// index of a free chunk of the pool, -1 when every one is taken or there is no memory for it
+static int take_rx_chunk() {
+    for (size_t i = 0; i < rx_chunk_count; ++i) {
+        uint8_t bit = 1 << i;
+        if (rx_chunks_taken.fetch_or(bit) & bit) 
+            continue;
+
+        if (rx_chunks[i].len() == 0 && etl::heap::freeSize >= rx_chunk_size) {
+            rx_chunks[i] = etl::vector_allocate<uint8_t>(rx_chunk_size);
+        }
+        if (rx_chunks[i].len() == 0) {
+            rx_chunks_taken &= ~bit;
+            return -1;
+        }
+        return i;
+    }
+    return -1;
 }
 
 auto detail::tcp_receive(int socket_number) -> etl::Result<etl::Vector<uint8_t>, osStatus_t> {
@@ -263,29 +819,54 @@ auto detail::tcp_receive(int socket_number) -> etl::Result<etl::Vector<uint8_t>,
         return etl::Err(osErrorNoMemory);
     }
 
-    auto res = etl::vector_allocate<uint8_t>(len);
-    ::recv(socket_number, res.data(), len);
+    // what the chip holds now is read straight into the result, unless a full RX buffer may be followed by more
+    const size_t rx_max = ::getSn_RxMAX(socket_number);
+    int first = len < rx_max ? -1 : take_rx_chunk();
+    if (first < 0) {
+        auto res = etl::vector_allocate<uint8_t>(len);
+        if (tcp_receive_into(socket_number, res.data(), len) != len) {
+            return etl::Err(osError);
+        }
+        return etl::Ok(mv | res);
+    }
 
-    while (len == 2048) {
-        etl::this_thread::sleep(10ms);
-        size_t len2 = ::getSn_RX_RSR(socket_number);
-        if (etl::heap::freeSize < len) {
-            return etl::Err(osErrorNoMemory);
+    // RECV frees the RX buffer and the peer refills it, Sn_RX_RSR is polled again without waiting.
+    // What does not fit in the pool stays in the chip for the next receive
+    int chunks[rx_chunk_count] = {first};
+    size_t count = 1, used = 0, total = 0;
+    while (true) {
+        if (used == rx_chunk_size) {
+            int chunk = count < rx_chunk_count ? take_rx_chunk() : -1;
+            if (chunk < 0) break;
+            chunks[count++] = chunk;
+            used = 0;
         }
 
-        auto res2 = etl::vector_allocate<uint8_t>(len + len2);
-        ::memcpy(res2.data(), res.data(), res.len());
-        ::recv(socket_number, res2.data() + res.len(), len2);
-        
-        res = mv | res2;
-        len = len2;
+        auto n = tcp_receive_into(socket_number, rx_chunks[chunks[count - 1]].data() + used, rx_chunk_size - used);
+        if (n == 0) break;
+        used += n;
+        total += n;
     }
 
-    if (res.len() == 0) {
+    auto res = total > 0 && etl::heap::freeSize >= total ? etl::vector_allocate<uint8_t>(total) : etl::Vector<uint8_t>();
+    if (res.len() == total) {
+        for (size_t i = 0; i < count; ++i) {
+            size_t n = etl::min(total - i * rx_chunk_size, rx_chunk_size);
+            ::memcpy(res.data() + i * rx_chunk_size, rx_chunks[chunks[i]].data(), n);
+        }
+    }
+    for (size_t i = 0; i < count; ++i) {
+        rx_chunks_taken &= ~(1 << chunks[i]);
+    }
+
+    if (total == 0) {
         return etl::Err(osError);
-    } else {
-        return etl::Ok(mv | res);
+    } else if (res.len() != total) {
+        return etl::Err(osErrorNoMemory);
     }
+
+    Ethernet::self->socket_stats[socket_number].rx_copied += total;
+    return etl::Ok(mv | res);
 }
 
 auto detail::udp_receive(int socket_number, etl::Vector<uint8_t> ip) -> etl::Result<Project::etl::Vector<uint8_t>, osStatus_t> {
@@ -303,6 +884,11 @@ auto detail::udp_receive(int socket_number, etl::Vector<uint8_t> ip) -> etl::Res
         
         uint16_t port_dummy;
         ::recvfrom(socket_number, res_new.data() + res.len(), len, ip.data(), &port_dummy);
+
+        auto& stats = Ethernet::self->socket_stats[socket_number];
+        stats.rx_bytes += len;
+        stats.rx_copied += res.len();
+        stats.recv_commands++;
         res = etl::move(res_new);
     }
 
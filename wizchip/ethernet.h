@@ -2,12 +2,17 @@
 #define WIZCHIP_ETHERNET_H
 
 #include "wizchip_conf.h"
-#include "spi.h"
-#include "periph/gpio.h"
+#include "cmsis_os2.h"
 #include "etl/mutex.h"
 #include "etl/vector.h"
 #include "etl/future.h"
 #include "wizchip/stream.h"
+#include "wizchip/bus.h"
+#include <atomic>
+
+#ifndef WIZCHIP_HOST
+#include "wizchip/spi_bus.h"
+#endif
 
 namespace Project::wizchip {
     class SocketServer;
@@ -19,16 +24,32 @@ namespace Project::wizchip {
         friend class SocketSession;
 
     public:
+        /// TX/RX buffer size of each socket in KB, each direction shares 16 KB. Valid sizes are 0, 1, 2, 4, 8 and 16,
+        /// other sizes are rounded up to the next valid one
+        struct Memsize {
+            uint8_t tx[_WIZCHIP_SOCK_NUM_];
+            uint8_t rx[_WIZCHIP_SOCK_NUM_];
+        };
+
         /// Arguments structure for initializing the Ethernet class.
+        /// A host build (WIZCHIP_HOST) has no SPI peripheral nor reset pin, the chip is reached through bus only
         struct Args {
+#ifndef WIZCHIP_HOST
             SPI_HandleTypeDef& hspi;                ///< SPI handler
             periph::GPIO cs;                        ///< Chip select pin.
             periph::GPIO rst;                       ///< Reset pin.
+#endif
             wiz_NetInfo netInfo;                    ///< network information.
+            bool interrupt = false;                 ///< event-driven mode, irq_handler() must be called on INTn falling edge.
+            Bus* bus = nullptr;                     ///< register access bus, hspi and cs are used when null. Required in a host build.
+#ifndef WIZCHIP_HOST
+            bool dma = false;                       ///< DMA burst transfers on hspi, see SpiBus::complete_handler.
+#endif
+            Memsize memsize = {};                   ///< TX/RX buffer size of each socket in KB, 2 KB each when empty.
         };
 
         /// default constructor
-        explicit Ethernet(Args args) : hspi(args.hspi), cs(args.cs), rst(args.rst), netInfo(args.netInfo) {}
+        explicit Ethernet(Args args);
         
         static Ethernet* self;
 
@@ -43,29 +64,110 @@ namespace Project::wizchip {
         void setNetInfo(const wiz_NetInfo& netInfo);
         const wiz_NetInfo& getNetInfo();
 
+        /// INTn handler, safe to be called from interrupt context
+        void irq_handler();
+
+#ifndef WIZCHIP_HOST
+        /// SPI DMA transfer complete handler, safe to be called from interrupt context
+        void spi_complete_handler(SPI_HandleTypeDef* hspi) { spi_bus.complete_handler(hspi); }
+#endif
+
+        /// in interrupt mode, the longest time in ms the event loop sleeps without any interrupt
+        uint32_t idle_timeout_ms = 500;
+
         struct Logger {
             std::function<void(const char*)> function;
             Logger& operator<<(const char* msg) { if (function) function(msg); return *this; }
         } logger = {};
 
+        /// socket allocation and network settings, held briefly. Each register access takes the bus lock on its own
         etl::Mutex mutex;
 
+        /// state of each socket: serviced by the event loop under it, taken by workers for commands such as disconnect.
+        /// Sockets do not wait for each other, only for the bus during an SPI transaction
+        etl::Mutex socket_mutex[_WIZCHIP_SOCK_NUM_];
+
+        struct SocketStats {
+            uint32_t rx_bytes;                  ///< bytes read out of the chip RX buffer.
+            uint32_t rx_copied;                 ///< bytes copied again after being read out of the chip.
+            uint32_t recv_commands;             ///< number of RECV commands issued.
+            uint32_t tx_bytes;                  ///< bytes written into the chip TX buffer.
+            uint32_t send_commands;             ///< number of SEND commands issued.
+        };
+        SocketStats socket_stats[_WIZCHIP_SOCK_NUM_] = {};
+
+        /// current buffer layout
+        const Memsize& getMemsize() const { return memsize; }
+
+        /// buffer layout that fits the traffic recorded in socket_stats, to be passed as Args::memsize on the next start
+        Memsize buffer_profile() const;
+
+        /// bytes queued for each TCP socket, a sender blocks while the queue of its socket is full
+        size_t tx_queue_size = 2048;
+
+        /// queue the stream on a TCP socket, the event loop writes it into the chip as Sn_TX_FSR frees.
+        /// Only one sender per socket at a time. No lock is taken, the caller blocks only while the queue is full.
+        /// The future completes with the bytes sent once the last one got SENDOK, or a negative SOCKERR
+        etl::Future<int> send(int socket_number, Stream& s);
+
+        /// queue the whole stream without waiting, for the event loop itself.
+        /// False when it does not fit in the free part of the queue, nothing is sent then
+        bool try_send(int socket_number, Stream& s);
+
+        /// how long a client session waits for a socket when every one is taken
+        uint32_t session_timeout_ms = 1000;
+
+        /// queued bytes of the socket are not all confirmed by SENDOK yet
+        bool sending(int socket_number) const { return tx_queues[socket_number].acked != tx_queues[socket_number].head; }
+
     private:
         void execute();
+        void service(int socket_number);
+        void drain(int socket_number);
 
-        SPI_HandleTypeDef& hspi;
-        periph::GPIO cs;
+        /// socket for a client session: a free one, else an idle listening socket lent by a server above its minimum.
+        /// Waits up to timeout_ms for one to be released, -1 when none is
+        int acquire_socket(uint32_t timeout_ms);
+        void release_socket(int socket_number);
+        void wake(int socket_number);
+        bool resize_buffers(const Memsize& sizes);
+
+#ifndef WIZCHIP_HOST
+        SpiBus spi_bus;
         periph::GPIO rst;
+#endif
         wiz_NetInfo netInfo;
+        bool interrupt;
+        Bus* bus;
+        Memsize memsize;
 
         bool _is_running = false;
 
+        osSemaphoreId_t irq_semaphore = nullptr;
+        osMutexId_t bus_mutex = nullptr;        ///< held for one SPI transaction, see reg_wizchip_cris_cbfunc.
+        osSemaphoreId_t socket_released = nullptr;  ///< sessions waiting for a socket are woken when one is returned.
+        std::atomic<uint8_t> pending_sockets = 0;
+
         struct SocketHandler {
             SocketServer* socket_interface;    
             bool socket_session;
+            SocketServer* lent_from;        ///< server the session socket goes back to when released.
             bool is_busy() const { return socket_interface || socket_session; }
         };
         SocketHandler socket_handlers[_WIZCHIP_SOCK_NUM_] = {};
+
+        /// ring of outgoing bytes, filled by the sender and drained by the event loop. The counters only grow
+        struct TxQueue {
+            etl::Vector<uint8_t> ring;
+            std::atomic<uint32_t> head;     ///< bytes queued by the sender.
+            std::atomic<uint32_t> tail;     ///< bytes written into the chip TX buffer.
+            std::atomic<uint32_t> acked;    ///< bytes confirmed by SENDOK, a SEND is in flight while less than tail.
+            std::atomic<int> err;           ///< SOCKERR that dropped the queue, cleared by the next send on an idle queue.
+        };
+        TxQueue tx_queues[_WIZCHIP_SOCK_NUM_] = {};
+
+        /// queue of the socket for a new send, an idle queue is reset and gets its ring
+        TxQueue& send_queue(int socket_number);
     };
     
     [[interface]]
@@ -81,9 +183,13 @@ namespace Project::wizchip {
 
         struct StartArgs {
             int port;
-            int number_of_socket = 1;
+            int number_of_socket = 1;   ///< sockets reserved, the most connections served at once.
+            int min_sockets = -1;       ///< sockets kept for the server, idle listening ones above it may be lent to client sessions. -1 keeps them all.
+            int tx_buffer_kb = 0;       ///< TX buffer of each socket, 0 keeps the Ethernet layout.
+            int rx_buffer_kb = 0;       ///< RX buffer of each socket, 0 keeps the Ethernet layout.
         };
 
+        /// fails with osErrorResource when running, or when tx_buffer_kb or rx_buffer_kb can not be applied
         etl::Result<void, osStatus_t> start(StartArgs);
         void stop();
         bool isRunning() const;
@@ -91,6 +197,9 @@ namespace Project::wizchip {
         int port;
 
     protected:
+        /// false when the buffers can not be given the requested sizes, the layout is then left as it was
+        bool resize_buffers(int tx_kb, int rx_kb);
+
         virtual const char* kind() = 0;
         virtual int on_init(int socket_number) = 0;
         virtual int on_listen(int socket_number) = 0;
@@ -100,6 +209,8 @@ namespace Project::wizchip {
         virtual Stream response(int socket_number, etl::Vector<uint8_t>) = 0;
 
         etl::Vector<int> reserved_sockets;
+        int min_sockets = 0;
+        int lent = 0;                   ///< reserved sockets currently lent to client sessions.
     };
 
     [[interface]]
@@ -110,11 +221,23 @@ namespace Project::wizchip {
         SocketSession(uint8_t protocol, uint8_t flag, etl::Vector<uint8_t> host, int port);
         ~SocketSession();
 
+        /// disable copy constructor and assignment
+        SocketSession(const SocketSession&) = delete;
+        SocketSession& operator=(const SocketSession&) = delete;
+
         etl::Vector<uint8_t> host;
         int port;
-        int socket_number;
+        int socket_number;              ///< -1 when no socket was free within Ethernet::session_timeout_ms.
 
         virtual etl::Future<etl::Vector<uint8_t>> request(Stream s) = 0;
+
+    protected:
+        /// close the socket and open it again on a new local port, e.g. after the peer closed the connection
+        void reopen();
+
+    private:
+        uint8_t protocol;
+        uint8_t flag;
     };
 } 
 
@@ -122,8 +245,15 @@ namespace Project::wizchip::detail {
     etl::Vector<uint8_t> ipv4_to_bytes(const char* ip);
     etl::Pair<etl::Vector<uint8_t>, uint16_t> ipv4_port_to_pair(const char* ip_port);
     
+    /// what the chip holds, gathered while the RX buffer refills, without waiting
     etl::Result<etl::Vector<uint8_t>, osStatus_t> tcp_receive(int socket_number);
-    void tcp_receive_to(int socket_number, uint8_t* buf, size_t n);
+    size_t tcp_receive_into(int socket_number, uint8_t* buf, size_t n);
+    /// waits for n bytes, returns fewer when the socket leaves ESTABLISHED or timeout_ms passes first
+    size_t tcp_receive_to(int socket_number, uint8_t* buf, size_t n, uint32_t timeout_ms);
+    /// queued on Ethernet::send and waited for, the socket mutex must not be held
+    int tcp_send(int socket_number, const uint8_t* buf, size_t n);
+    int tcp_send(int socket_number, Stream& s);
+    int udp_send(int socket_number, const uint8_t* buf, size_t n, const uint8_t* ip, uint16_t port);
     etl::Result<etl::Vector<uint8_t>, osStatus_t> udp_receive(int socket_number, etl::Vector<uint8_t> ip);
 }
 
@@ -0,0 +1,24 @@
+#include "wizchip/http/arena.h"
+
+using namespace Project::wizchip;
+
+http::Arena::Arena(size_t size) : block(etl::vector_allocate<uint8_t>(size)) {}
+
+void* http::Arena::allocate(size_t len, size_t align) {
+    auto base = reinterpret_cast<uintptr_t>(block.data());
+    auto start = ((base + top + align - 1) & ~uintptr_t(align - 1)) - base;
+    if (block.len() == 0) 
+        return nullptr;
+    if (start + len > block.len()) {
+        overflows++;
+        return nullptr;
+    }
+
+    top = start + len;
+    if (top > high_water) high_water = top;
+    return block.data() + start;
+}
+
+void http::Arena::reset() {
+    top = 0;
+}
@@ -0,0 +1,35 @@
+#ifndef WIZCHIP_HTTP_ARENA_H
+#define WIZCHIP_HTTP_ARENA_H
+
+#include "etl/vector.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace Project::wizchip::http {
+    /// Bump allocator over one block that is allocated once and kept.
+    /// Everything a request allocates from it is released in one step by reset(),
+    /// so the heap does not see the short lived buffers of each request
+    class Arena {
+    public:
+        Arena() = default;
+        explicit Arena(size_t size);
+
+        /// bytes valid until the next reset, null when they do not fit in the rest of the block
+        void* allocate(size_t len, size_t align = alignof(std::max_align_t));
+
+        /// release everything allocated since the last reset
+        void reset();
+
+        size_t capacity() const { return block.len(); }
+        size_t used() const { return top; }
+
+        size_t high_water = 0;      ///< most bytes in use between two resets.
+        uint32_t overflows = 0;     ///< allocations that did not fit in the block, not counted while there is no block.
+
+    private:
+        etl::Vector<uint8_t> block;
+        size_t top = 0;
+    };
+}
+
+#endif
@@ -1,7 +1,10 @@
 #include "Ethernet/socket.h"
 #include "wizchip/http/client.h"
+#include "wizchip/http/connection_pool.h"
 #include "etl/heap.h"
 #include "etl/keywords.h"
+#include <memory>
+#include <optional>
 
 using namespace Project::wizchip;
 
@@ -13,7 +16,146 @@ http::Client::Client(std::string host) : Client(tcp::Client::Args{{}, 0}) {
 void debug_cnt(const char* format, size_t s1, size_t s2);
 void debug_str(const char* format, const char* str, size_t len);
 
-auto http::Client::request(http::Request req) -> etl::Future<http::Response> {
+namespace {
+    /// bytes read out of the socket and not consumed yet, responses of a pipeline follow each other in it
+    struct Receiver {
+        int socket_number = -1;
+        etl::Vector<uint8_t> buf = {};
+        size_t begin = 0;
+        size_t end = 0;
+        size_t total = 0;   ///< bytes read out of the socket so far.
+
+        /// the only buffer of the transfer, besides the head and a buffered body
+        bool allocate(size_t size) {
+            if (etl::heap::freeSize < size) return false;
+            buf = etl::vector_allocate<uint8_t>(size);
+            return true;
+        }
+
+        const uint8_t* data() const { return buf.data() + begin; }
+        size_t len() const { return end - begin; }
+        void consume(size_t n) { begin += n; }
+
+        /// waits for the next bytes once all are consumed, 0 once the peer closed and nothing is left
+        etl::Result<size_t, osStatus_t> fill(etl::Time start_time, etl::Time timeout) {
+            begin = end = 0;
+            while (etl::time::elapsed(start_time) < timeout) {
+                auto n = detail::tcp_receive_into(socket_number, buf.data(), buf.len());
+                if (n > 0) {
+                    end = n;
+                    total += n;
+                    return etl::Ok(n);
+                }
+                if (getSn_SR(socket_number) != SOCK_ESTABLISHED) return etl::Ok(size_t(0));
+                etl::this_thread::sleep(1ms);
+            }
+            return etl::Err(osErrorTimeout);
+        }
+    };
+
+    /// receive one response, consuming exactly its bytes so that the next response stays in the receiver
+    auto receive_response(Receiver& rx, bool head_request, const http::BodySink& sink, etl::Time start_time, etl::Time timeout) 
+    -> etl::Result<http::Response, osStatus_t> {
+        // the head is kept until it is parsed
+        auto parser = http::Parser();
+        auto head = etl::Vector<uint8_t>();
+        while (not parser.done()) {
+            if (rx.len() == 0) {
+                auto r = rx.fill(start_time, timeout);
+                if (r.is_err()) return etl::Err(r.unwrap_err());
+                if (r.unwrap() == 0) return etl::Err(osError);
+            }
+
+            auto used = parser.feed(rx.data(), rx.len());
+            if (parser.failed()) {
+                return etl::Err(osError);
+            }
+            if (etl::heap::freeSize < head.len() + used) {
+                return etl::Err(osErrorNoMemory);
+            }
+
+            auto joined = etl::vector_allocate<uint8_t>(head.len() + used);
+            ::memcpy(joined.data(), head.data(), head.len());
+            ::memcpy(joined.data() + head.len(), rx.data(), used);
+            head = etl::move(joined);
+            rx.consume(used);
+        }
+
+        auto response = http::Response::parse(mv | head);
+        response.body.clear();
+        if (head_request || response.status / 100 == 1 || response.status == 204 || response.status == 304) {
+            return etl::Ok(mv | response);
+        }
+
+        // without a sink the body is collected into the response
+        bool no_memory = false;
+        if (not sink && parser.has_content_length) {
+            if (etl::heap::freeSize < parser.content_length) return etl::Err(osErrorNoMemory);
+            response.body.reserve(parser.content_length);
+        }
+        auto deliver = [&](const uint8_t* data, size_t len) {
+            if (sink) return sink(data, len);
+            if (etl::heap::freeSize < len) {
+                no_memory = true;
+                return false;
+            }
+            response.body.append(reinterpret_cast<const char*>(data), len);
+            return true;
+        };
+
+        // the body is delimited by its chunks, its length, or by the peer closing the connection
+        auto decoder = http::ChunkDecoder();
+        auto body_sink = http::BodySink(deliver);
+        size_t remaining = parser.content_length;
+        while (true) {
+            if (parser.chunked ? decoder.done() : parser.has_content_length && remaining == 0) {
+                break;
+            }
+
+            if (rx.len() == 0) {
+                auto r = rx.fill(start_time, timeout);
+                if (r.is_err()) return etl::Err(r.unwrap_err());
+                if (r.unwrap() == 0) {
+                    if (parser.chunked || parser.has_content_length) return etl::Err(osError);
+                    break;
+                }
+            }
+
+            bool ok = true;
+            if (parser.chunked) {
+                rx.consume(decoder.feed(rx.data(), rx.len(), body_sink));
+                ok = not decoder.failed();
+            } else if (parser.has_content_length) {
+                auto k = etl::min(rx.len(), remaining);
+                ok = deliver(rx.data(), k);
+                remaining -= k;
+                rx.consume(k);
+            } else {
+                ok = deliver(rx.data(), rx.len());
+                rx.consume(rx.len());
+            }
+
+            if (not ok) {
+                return etl::Err(no_memory ? osErrorNoMemory : osError);
+            }
+        }
+
+        return etl::Ok(mv | response);
+    }
+
+    /// state shared by the futures of a pipeline
+    struct Pipeline {
+        etl::LinkedList<Stream> streams;
+        std::vector<bool> head_requests;
+        std::vector<std::optional<http::Response>> responses;
+        size_t received = 0;            ///< responses read out of the connection.
+        bool sent = false;
+        osStatus_t error = osOK;        ///< breaks the pipeline, every response not received yet fails with it.
+        Receiver rx;
+    };
+}
+
+void http::Client::prepare(Request& req) {
     req.headers["User-Agent"] = "stm32_wizchip/" WIZCHIP_VERSION;
     if (!req.body.empty()) req.headers["Content-Length"] = std::to_string(req.body.size());
     req.headers["Host"] = std::to_string(host[0]) + '.' + 
@@ -21,42 +163,100 @@ auto http::Client::request(http::Request req) -> etl::Future<http::Response> {
                           std::to_string(host[2]) + '.' + 
                           std::to_string(host[3]) + ':' + 
                           std::to_string(port);
+}
+
+auto http::Client::request(http::Request req, BodySink sink) -> etl::Future<http::Response> {
+    prepare(req);
+
+    bool head_request = req.method == "HEAD";
+    return [this, s=req.dump(), head_request, sink=etl::move(sink)](etl::Time timeout) mutable -> etl::Result<http::Response, osStatus_t> {
+        auto start_time = etl::time::now();
+        received = 0;
+        auto sent = send(s, timeout);
+        if (sent.is_err()) {
+            return etl::Err(sent.unwrap_err());
+        }
+
+        auto rx = Receiver{socket_number};
+        if (not rx.allocate(receive_buffer_size)) {
+            return etl::Err(osErrorNoMemory);
+        }
+
+        auto res = receive_response(rx, head_request, sink, start_time, timeout);
+        received = rx.total;
+        return res;
+    };
+}
+
+auto http::Client::pipeline(std::vector<Request> batch) -> std::vector<etl::Future<Response>> {
+    auto state = std::make_shared<Pipeline>();
+    state->head_requests.reserve(batch.size());
+    state->responses.resize(batch.size());
+    for (auto& req : batch) {
+        prepare(req);
+        state->head_requests.push_back(req.method == "HEAD");
+        state->streams << req.dump();
+    }
 
-    return tcp::Client::request(req.dump())
-        .and_then([this](etl::Vector<uint8_t> data) -> etl::Result<http::Response, osStatus_t> {
-            auto response = http::Response::parse(mv | data);
+    auto futures = std::vector<etl::Future<Response>>();
+    futures.reserve(batch.size());
+    for (size_t i = 0; i < batch.size(); ++i) {
+        futures.push_back([this, state, i](etl::Time timeout) -> etl::Result<http::Response, osStatus_t> {
+            auto start_time = etl::time::now();
+            auto& p = *state;
 
-            int len = 0;
-            if (response.headers.has("Content-Length")) {
-                len = etl::string_view(response.headers["Content-Length"].c_str()).to_int() - response.body.size();
-            } else if (response.headers.has("content-length")) {
-                len = etl::string_view(response.headers["content-length"].c_str()).to_int() - response.body.size();
+            // the first wait sends the whole batch, the requests are queued back to back and the chip sends them
+            // in as few segments as the queue allows, only the last one is waited for
+            if (not p.sent) {
+                p.sent = true;
+                auto connected = connect(timeout);
+                p.rx.socket_number = socket_number;
+                if (connected.is_err()) {
+                    p.error = connected.unwrap_err();
+                } else if (not p.rx.allocate(receive_buffer_size)) {
+                    p.error = osErrorNoMemory;
+                } else {
+                    auto queued = std::vector<etl::Future<int>>();
+                    queued.reserve(p.streams.len());
+                    for (; p.streams.len() > 1; p.streams.pop_front()) {
+                        queued.push_back(Ethernet::self->send(socket_number, p.streams.front()));
+                    }
+                    if (detail::tcp_send(socket_number, p.streams.front()) < 0) {
+                        p.error = osError;
+                    }
+                    p.streams.pop_front();
+
+                    // the queue is sent in order, the ones before the last are done once it is
+                    for (auto& sent : queued) {
+                        auto r = sent.wait(timeout);
+                        if (r.is_err() || r.unwrap() < 0) p.error = osError;
+                    }
+                }
             }
 
-            if (int(etl::heap::freeSize) < len) {
-                return etl::Err(osErrorNoMemory);
-            } else if (len > 0) {
-                auto body_size = response.body.size();
-                response.body.resize(body_size + len);
-                detail::tcp_receive_to(socket_number, reinterpret_cast<uint8_t*>(&response.body[body_size]), len);
-            } else if (len < 0) {
-                response.body.resize(response.body.size() + len);
-            } 
+            // responses come in the order of the requests, those before this one are kept for their futures
+            while (p.error == osOK && p.received <= i) {
+                auto res = receive_response(p.rx, p.head_requests[p.received], {}, start_time, timeout);
+                if (res.is_err()) {
+                    // the bytes of a partly received response can not be told apart from the next one
+                    p.error = res.unwrap_err();
+                    break;
+                }
+                p.responses[p.received++] = mv | res.unwrap();
+            }
 
-            return etl::Ok(mv | response);
+            if (p.responses[i]) {
+                auto response = mv | *p.responses[i];
+                p.responses[i].reset();
+                return etl::Ok(mv | response);
+            }
+            return etl::Err(p.error != osOK ? p.error : osError);
         });
+    }
+
+    return futures;
 }
 
 auto http::request(std::string method, URL url, HeadersBody headers_body) -> etl::Future<Response> {
-    return [method=etl::move(method), url=etl::move(url), headers_body=etl::move(headers_body)](etl::Time timeout) mutable -> etl::Result<Response, osStatus_t> {
-        auto cli = Client(url.host);
-        return cli.request(Request{
-            .method=etl::move(method),
-            .path=etl::move(url.full_path),
-            .version="HTTP/1.1",
-            .headers=etl::move(headers_body.headers),
-            .body=etl::move(headers_body.body),
-        }).wait(timeout);
-    };
+    return default_pool().request(etl::move(method), etl::move(url), etl::move(headers_body));
 }
-
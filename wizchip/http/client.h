@@ -4,6 +4,8 @@
 #include "wizchip/tcp/client.h"
 #include "wizchip/http/request.h"
 #include "wizchip/http/response.h"
+#include "wizchip/http/parser.h"
+#include <vector>
 
 namespace Project::wizchip::http {
 
@@ -15,7 +17,18 @@ namespace Project::wizchip::http {
 
         using HandlerFunction = etl::Function<void(const Response&), void*>;
 
-        etl::Future<Response> request(Request req);
+        /// send the request and receive the response. Body bytes go to the sink as they arrive when one is given,
+        /// the response body is then left empty. Chunked bodies are decoded
+        etl::Future<Response> request(Request req, BodySink sink = {});
+
+        /// send the requests back to back on this connection without waiting for each response,
+        /// the responses are matched to the requests in order. The batch is sent by the first future waited for,
+        /// a response that fails or times out breaks the connection for the ones after it.
+        /// The futures share the connection and are waited for from one thread, bodies are collected
+        std::vector<etl::Future<Response>> pipeline(std::vector<Request> batch);
+
+        size_t receive_buffer_size = 512;   ///< bytes read out of the socket at once, the memory a streamed body takes.
+        size_t received = 0;                ///< response bytes read out of the socket by the last request().
 
         etl::Future<Response> Get(std::string path, etl::UnorderedMap<std::string, std::string> headers = {}, std::string body = "") { 
             return request({.method="GET", .path=etl::move(path), .version="HTTP/1.1", .headers=etl::move(headers), .body=etl::move(body)}); 
@@ -44,11 +57,15 @@ namespace Project::wizchip::http {
     
     protected:
         using tcp::Client::request;
+
+    private:
+        void prepare(Request& req);
     };
 
     struct HeadersBody {
         etl::UnorderedMap<std::string, std::string> headers = {};
         std::string body = "";
+        BodySink sink = {};     ///< streams the response body instead of collecting it, see Client::request.
     };
 
     etl::Future<Response> request(std::string method, URL url, HeadersBody headers_body);
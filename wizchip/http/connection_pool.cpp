@@ -0,0 +1,168 @@
+#include "Ethernet/socket.h"
+#include "wizchip/http/connection_pool.h"
+#include "wizchip/http/request_view.h"
+#include "etl/keywords.h"
+
+using namespace Project::wizchip;
+
+auto http::default_pool() -> ConnectionPool& {
+    static ConnectionPool pool;
+    return pool;
+}
+
+// the server lets the connection stay and the body was delimited, so nothing of this response is left unread
+static bool reusable(bool head_request, http::Response& res) {
+    std::string_view connection, content_length, transfer_encoding;
+    for (auto &[key, value] : res.headers) {
+        if (http::equals_ignore_case(key, "Connection")) connection = value;
+        if (http::equals_ignore_case(key, "Content-Length")) content_length = value;
+        if (http::equals_ignore_case(key, "Transfer-Encoding")) transfer_encoding = value;
+    }
+
+    bool keep = res.version == "HTTP/1.0" ? http::equals_ignore_case(connection, "keep-alive") : not http::equals_ignore_case(connection, "close");
+    bool chunked = transfer_encoding.find("chunked") != std::string_view::npos;
+    bool delimited = chunked || not content_length.empty() || head_request || res.status == 204 || res.status == 304;
+    return keep && delimited;
+}
+
+auto http::ConnectionPool::request(std::string method, URL url, HeadersBody headers_body) -> etl::Future<Response> {
+    return [this, method=etl::move(method), url=etl::move(url), headers_body=etl::move(headers_body)](etl::Time timeout) mutable -> etl::Result<Response, osStatus_t> {
+        auto req = Request{
+            .method=etl::move(method),
+            .path=etl::move(url.full_path),
+            .version="HTTP/1.1",
+            .headers=etl::move(headers_body.headers),
+            .body=etl::move(headers_body.body),
+        };
+
+        bool head_request = req.method == "HEAD";
+        bool idempotent = head_request || req.method == "GET" || req.method == "PUT" || req.method == "DELETE" || 
+                          req.method == "OPTIONS" || req.method == "TRACE";
+
+        // a retry would deliver the body again, it is only done while the sink has seen nothing
+        bool delivered = false;
+        auto sink = headers_body.sink ? BodySink([&delivered, &headers_body](const uint8_t* data, size_t len) {
+            delivered = true;
+            return headers_body.sink(data, len);
+        }) : BodySink();
+
+        // a kept connection may have been closed by the server just before the request. An idempotent request
+        // is sent once more on a new connection when nothing of the response came, within what is left of the timeout
+        auto start_time = etl::time::now();
+        for (int attempt = 0; attempt < 2; ++attempt) {
+            auto left = timeout;
+            left.tick -= etl::min(left.tick, etl::time::elapsed(start_time).tick);
+
+            bool reused = false;
+            auto conn = acquire(url.host, reused);
+            if (conn == nullptr) {
+                // every pooled connection is busy, this request gets its own
+                auto cli = Client(url.host);
+                return cli.request(mv | req, sink).wait(left);
+            }
+
+            auto& cli = *conn->client;
+            auto res = cli.request(reused && idempotent ? req : mv | req, sink).wait(left);
+            bool closed = res.is_err() && cli.received == 0 && getSn_SR(cli.socket_number) != SOCK_ESTABLISHED;
+            release(conn, res.is_ok() && reusable(head_request, res.unwrap()));
+
+            if (res.is_ok() || not (reused && idempotent && closed) || delivered) 
+                return res;
+
+            {
+                auto lock = mutex.lock().await();
+                metrics.retried++;
+            }
+            if (etl::time::elapsed(start_time) >= timeout) 
+                return etl::Err(osErrorTimeout);
+        }
+
+        return etl::Err(osError);
+    };
+}
+
+void http::ConnectionPool::evict() {
+    auto lock = mutex.lock().await();
+    evict_locked();
+}
+
+void http::ConnectionPool::evict_locked() {
+    auto now = etl::time::now().tick;
+    for (auto& conn : connections) {
+        if (conn.busy || not conn.client) 
+            continue;
+
+        bool idle = now - conn.last_used >= idle_timeout_ms;
+        bool closed = getSn_SR(conn.client->socket_number) != SOCK_ESTABLISHED;
+        if (idle || closed) {
+            conn.client.reset();
+            metrics.evicted++;
+        }
+    }
+}
+
+auto http::ConnectionPool::acquire(const std::string& key, bool& reused) -> Connection* {
+    Connection* slot = nullptr;
+    {
+        auto lock = mutex.lock().await();
+        evict_locked();
+
+        size_t open = 0;
+        for (auto& conn : connections) {
+            if (not conn.client && not conn.busy) {
+                if (slot == nullptr) slot = &conn;
+                continue;
+            }
+
+            open++;
+            if (not conn.busy && conn.key == key) {
+                conn.busy = true;
+                reused = true;
+                metrics.reused++;
+                return &conn;
+            }
+        }
+
+        // a full pool gives up its least recently used idle connection
+        if (open >= etl::min(max_connections, capacity)) {
+            slot = nullptr;
+            for (auto& conn : connections) {
+                if (conn.client && not conn.busy && (slot == nullptr || int32_t(conn.last_used - slot->last_used) < 0)) slot = &conn;
+            }
+            if (slot == nullptr) 
+                return nullptr;
+
+            slot->client.reset();
+            metrics.evicted++;
+        }
+
+        if (slot == nullptr) 
+            return nullptr;
+
+        slot->busy = true;
+        slot->key = key;
+    }
+
+    // waiting for a socket does not hold up the other connections
+    auto client = std::make_unique<Client>(key);
+    if (client->socket_number < 0) {
+        auto lock = mutex.lock().await();
+        slot->busy = false;
+        return nullptr;
+    }
+
+    auto lock = mutex.lock().await();
+    slot->client = etl::move(client);
+    metrics.created++;
+    return slot;
+}
+
+void http::ConnectionPool::release(Connection* conn, bool keep) {
+    auto lock = mutex.lock().await();
+    conn->busy = false;
+    conn->last_used = etl::time::now().tick;
+    if (not keep) {
+        conn->client.reset();
+        metrics.evicted++;
+    }
+}
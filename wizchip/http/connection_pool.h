@@ -0,0 +1,60 @@
+#ifndef WIZCHIP_HTTP_CONNECTION_POOL_H
+#define WIZCHIP_HTTP_CONNECTION_POOL_H
+
+#include "wizchip/http/client.h"
+#include "etl/mutex.h"
+#include <memory>
+
+namespace Project::wizchip::http {
+    /// Connections kept open between requests, keyed by host:port.
+    /// A connection is reused for the next request to the same host when the response allowed it,
+    /// and closed when idle for longer than idle_timeout_ms or closed by the server
+    class ConnectionPool {
+    public:
+        static constexpr size_t capacity = _WIZCHIP_SOCK_NUM_;
+
+        struct Stats {
+            uint32_t created;           ///< connections opened.
+            uint32_t reused;            ///< requests sent on a kept connection.
+            uint32_t evicted;           ///< connections closed for being idle, closed by the server or not reusable.
+            uint32_t retried;           ///< requests sent again after a kept connection closed before any response byte.
+        };
+
+        ConnectionPool() { mutex.init(); }
+
+        /// disable copy constructor and assignment
+        ConnectionPool(const ConnectionPool&) = delete;
+        ConnectionPool& operator=(const ConnectionPool&) = delete;
+
+        size_t max_connections = 2;         ///< sockets the pool keeps at most, up to capacity.
+        uint32_t idle_timeout_ms = 5000;    ///< kept connections unused for this long are closed.
+
+        etl::Future<Response> request(std::string method, URL url, HeadersBody headers_body);
+
+        /// close idle connections past the timeout and those closed by the server, also done on every request
+        void evict();
+
+        Stats stats() const { return metrics; }
+
+    private:
+        struct Connection {
+            std::string key;                ///< host:port
+            std::unique_ptr<Client> client;
+            bool busy;
+            uint32_t last_used;             ///< tick of the end of the last request.
+        };
+
+        Connection* acquire(const std::string& key, bool& reused);
+        void release(Connection* conn, bool keep);
+        void evict_locked();
+
+        Connection connections[capacity] = {};
+        etl::Mutex mutex;
+        Stats metrics = {};
+    };
+
+    /// pool used by http::request()
+    ConnectionPool& default_pool();
+}
+
+#endif // WIZCHIP_HTTP_CONNECTION_POOL_H
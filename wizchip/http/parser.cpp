@@ -0,0 +1,212 @@
+#include "wizchip/http/parser.h"
+
+using namespace Project::wizchip;
+
+static constexpr char content_length_name[] = "content-length";
+static constexpr char transfer_encoding_name[] = "transfer-encoding";
+static constexpr char chunked_token[] = "chunked";
+
+static constexpr char lower(uint8_t ch) {
+    return (ch >= 'A' && ch <= 'Z') ? ch - 'A' + 'a' : ch;
+}
+
+void http::Parser::reset() {
+    *this = Parser(limits);
+}
+
+void http::Parser::fail(Error err) {
+    error = err;
+    state = State::Failed;
+}
+
+void http::Parser::end_field() {
+    if (field == Field::TransferEncoding && token_match == sizeof(chunked_token) - 1) {
+        chunked = true;
+    }
+    if (field == Field::ContentLength) {
+        // a repeated Content-Length is only accepted with the same value
+        if (not length_digits || (has_content_length && length_value != content_length)) {
+            field = Field::Other;
+            return fail(Error::Malformed);
+        }
+        has_content_length = true;
+        content_length = length_value;
+    }
+    field = Field::Other;
+}
+
+size_t http::Parser::feed(const uint8_t* data, size_t len) {
+    size_t i = 0;
+    for (; i < len && state != State::Done && state != State::Failed; ++i) {
+        auto ch = data[i];
+        if (++size > limits.max_header_size) {
+            fail(Error::HeaderTooLarge);
+            break;
+        }
+
+        switch (state) {
+            case State::StartLine:
+                if (ch == '\n') {
+                    if (start_line_len == 0) fail(Error::Malformed);
+                    else state = State::LineStart;
+                } else if (ch != '\r') {
+                    start_line_len++;
+                }
+                break;
+
+            case State::LineStart:
+                if (ch == '\r') {
+                    state = State::HeadEnd;
+                    break;
+                }
+                if (ch == '\n') {
+                    state = State::Done;
+                    break;
+                }
+                if (header_count == limits.max_headers) {
+                    fail(Error::TooManyHeaders);
+                    break;
+                }
+                header_count++;
+                name_len = 0;
+                name_match[0] = name_match[1] = true;
+                state = State::Name;
+                [[fallthrough]];
+
+            case State::Name:
+                if (ch == ':') {
+                    if (name_match[0] && name_len == sizeof(content_length_name) - 1) {
+                        field = Field::ContentLength;
+                        length_value = 0;
+                        length_digits = false;
+                    } else if (name_match[1] && name_len == sizeof(transfer_encoding_name) - 1) {
+                        field = Field::TransferEncoding;
+                        token_match = 0;
+                    }
+                    state = State::Value;
+                } else if (ch == '\r' || ch == '\n') {
+                    fail(Error::Malformed);
+                } else {
+                    name_match[0] = name_match[0] && name_len < sizeof(content_length_name) - 1 && lower(ch) == content_length_name[name_len];
+                    name_match[1] = name_match[1] && name_len < sizeof(transfer_encoding_name) - 1 && lower(ch) == transfer_encoding_name[name_len];
+                    if (name_len < 0xFF) name_len++;
+                }
+                break;
+
+            case State::Value:
+                if (ch == '\n') {
+                    state = State::LineStart;
+                    end_field();
+                } else if (ch == '\r' || ch == ' ' || ch == '\t') {
+                    // whitespace around the value is not part of it
+                } else if (field == Field::ContentLength) {
+                    // a length that does not fit is malformed
+                    if (ch < '0' || ch > '9' || length_value > (SIZE_MAX - (ch - '0')) / 10) {
+                        fail(Error::Malformed);
+                    } else {
+                        length_value = length_value * 10 + (ch - '0');
+                        length_digits = true;
+                    }
+                } else if (field == Field::TransferEncoding && token_match < sizeof(chunked_token) - 1) {
+                    // "chunked" has no repeated prefix, a mismatch only has to check for a new start
+                    if (lower(ch) == chunked_token[token_match]) token_match++;
+                    else token_match = lower(ch) == chunked_token[0] ? 1 : 0;
+                }
+                break;
+
+            case State::HeadEnd:
+                if (ch == '\n') state = State::Done;
+                else fail(Error::Malformed);
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    if (state == State::Done) {
+        // the body length would be ambiguous, a way to smuggle a request past a proxy
+        if (chunked && has_content_length) fail(Error::Malformed);
+        else body_start = size;
+    }
+
+    return i;
+}
+
+static int hex_value(uint8_t ch) {
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    if (ch >= 'A' && ch <= 'F') return ch - 'A' + 10;
+    return -1;
+}
+
+void http::ChunkDecoder::end_size_line() {
+    if (digits == 0) state = State::Failed;
+    else if (remaining == 0) state = State::TrailerStart;
+    else state = State::Data;
+}
+
+size_t http::ChunkDecoder::feed(const uint8_t* data, size_t len, const BodySink& sink) {
+    size_t i = 0;
+    while (i < len && state != State::Done && state != State::Failed) {
+        auto ch = data[i];
+        switch (state) {
+            case State::Size:
+                if (auto value = hex_value(ch); value >= 0) {
+                    // a size that does not fit is malformed
+                    if (remaining > (SIZE_MAX >> 4)) state = State::Failed;
+                    remaining = remaining * 16 + value;
+                    digits++;
+                } else if (ch == '\n') {
+                    end_size_line();
+                } else if (ch != '\r') {
+                    state = State::Extension;
+                }
+                i++;
+                break;
+
+            case State::Extension:
+                if (ch == '\n') end_size_line();
+                i++;
+                break;
+
+            case State::Data: {
+                size_t n = remaining < len - i ? remaining : len - i;
+                if (not sink(data + i, n)) {
+                    state = State::Failed;
+                    break;
+                }
+                remaining -= n;
+                i += n;
+                if (remaining == 0) state = State::DataEnd;
+                break;
+            }
+
+            case State::DataEnd:
+                if (ch == '\n') {
+                    state = State::Size;
+                    digits = 0;
+                } else if (ch != '\r') {
+                    state = State::Failed;
+                }
+                i++;
+                break;
+
+            case State::TrailerStart:
+                if (ch == '\n') state = State::Done;
+                else if (ch != '\r') state = State::Trailer;
+                i++;
+                break;
+
+            case State::Trailer:
+                if (ch == '\n') state = State::TrailerStart;
+                i++;
+                break;
+
+            default:
+                break;
+        }
+    }
+
+    return i;
+}
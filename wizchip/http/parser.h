@@ -0,0 +1,89 @@
+#ifndef WIZCHIP_HTTP_PARSER_H
+#define WIZCHIP_HTTP_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace Project::wizchip::http {
+    /// Resumable parser of the head of a request or a response.
+    /// Bytes are fed as they come out of the socket, split anywhere, and nothing is buffered:
+    /// the caller keeps the bytes and parses the fields once the head is complete
+    class Parser {
+    public:
+        struct Limits {
+            size_t max_headers = 24;        ///< header lines, more than RequestView::max_headers are not kept by the view.
+            size_t max_header_size = 4096;  ///< start line and header lines in bytes, including line terminators.
+        };
+
+        enum class Error : uint8_t {
+            None,
+            Malformed,          ///< empty start line, a header line without a colon, or a Content-Length that is empty, overflows, repeats with another value or comes with chunked.
+            TooManyHeaders,
+            HeaderTooLarge,
+        };
+
+        Parser() : Parser(Limits{}) {}
+        explicit Parser(Limits limits) : limits(limits) {}
+
+        /// parse the next bytes of the message,
+        /// returns the number of bytes consumed, less than len when the head ends or fails inside the chunk
+        size_t feed(const uint8_t* data, size_t len);
+
+        /// start over for the next message, the limits are kept
+        void reset();
+
+        bool done() const { return state == State::Done; }
+        bool failed() const { return state == State::Failed; }
+
+        Limits limits;
+        Error error = Error::None;
+        size_t body_start = 0;          ///< offset of the first body byte from the message start, once done.
+        size_t header_count = 0;
+        size_t content_length = 0;
+        bool has_content_length = false;
+        bool chunked = false;           ///< Transfer-Encoding contains chunked.
+
+    private:
+        enum class State : uint8_t { StartLine, LineStart, Name, Value, HeadEnd, Done, Failed };
+        enum class Field : uint8_t { Other, ContentLength, TransferEncoding };
+
+        void fail(Error err);
+        void end_field();
+
+        State state = State::StartLine;
+        Field field = Field::Other;
+        size_t size = 0;                ///< bytes consumed of the current message.
+        size_t start_line_len = 0;
+        uint8_t name_len = 0;           ///< saturates, only the length of the known names matters.
+        bool name_match[2] = {};        ///< the name still matches content-length, transfer-encoding.
+        uint8_t token_match = 0;        ///< matched prefix of "chunked" in the Transfer-Encoding value.
+        size_t length_value = 0;        ///< Content-Length value being parsed.
+        bool length_digits = false;
+    };
+
+    /// takes the next body bytes as they are received, returns false to stop the transfer
+    using BodySink = std::function<bool(const uint8_t* data, size_t len)>;
+
+    /// Resumable decoder of a chunked body, bytes may be split anywhere.
+    /// Chunk data goes to the sink without being buffered, extensions and trailers are skipped
+    class ChunkDecoder {
+    public:
+        /// decode the next bytes, returns the number consumed, less than len once the last chunk and trailers end
+        size_t feed(const uint8_t* data, size_t len, const BodySink& sink);
+
+        bool done() const { return state == State::Done; }
+        bool failed() const { return state == State::Failed; }
+
+    private:
+        enum class State : uint8_t { Size, Extension, Data, DataEnd, TrailerStart, Trailer, Done, Failed };
+
+        void end_size_line();
+
+        State state = State::Size;
+        size_t remaining = 0;           ///< chunk size, then the bytes of the chunk still to come.
+        uint8_t digits = 0;
+    };
+}
+
+#endif
@@ -10,10 +10,6 @@ void wizchip_http_request_response_parse_headers_body(
     std::string& body
 );
 
-Stream::InRule wizchip_http_request_response_string_to_stream_rule(
-    std::string str
-);
-
 auto http::Request::parse(etl::Vector<uint8_t> buf) -> Request {
     auto sv = etl::string_view(buf.data(), buf.len());
 
@@ -50,23 +46,23 @@ auto http::Request::dump() -> Stream {
     static const uint8_t colon[] = {':', ' '};
 
     Stream s;
-    s << wizchip_http_request_response_string_to_stream_rule(mv | method);
+    s << etl::move(method);
     s << etl::iter(space);
-    s << wizchip_http_request_response_string_to_stream_rule(mv | path.url);
+    s << etl::move(path.url);
     s << etl::iter(space);
-    s << wizchip_http_request_response_string_to_stream_rule(mv | version);
+    s << etl::move(version);
     s << etl::iter(cr_lf);
     
     for (auto &[key, value] : headers) {
-        s << wizchip_http_request_response_string_to_stream_rule(mv | key);
+        s << etl::move(key);
         s << etl::iter(colon);
-        s << wizchip_http_request_response_string_to_stream_rule(mv | value);
+        s << etl::move(value);
         s << etl::iter(cr_lf);
     }
 
     s << etl::iter(cr_lf);
     if (!body.empty()) {
-        s << wizchip_http_request_response_string_to_stream_rule(mv | body);
+        s << etl::move(body);
     }
 
     return s;
@@ -94,10 +90,18 @@ void wizchip_http_request_response_parse_headers_body(
         body.assign(sv.data() + body_start, body_length);
     }
 
-    for (auto line : hsv.split<16>("\n")) {
-        auto kv = line.split<2>(":");
-        auto key = kv[0];
-        auto value = kv[1];
+    // every line is taken, the head size is bounded by the parser that framed it
+    while (hsv.len() > 0) {
+        auto eol = hsv.find("\n");
+        auto line = hsv.substr(0, eol < hsv.len() ? eol : hsv.len());
+        hsv = eol < hsv.len() ? hsv.substr(eol + 1, hsv.len() - eol - 1) : etl::StringView{};
+
+        auto colon = line.find(":");
+        if (colon >= line.len()) 
+            continue;
+
+        auto key = line.substr(0, colon);
+        auto value = line.substr(colon + 1, line.len() - colon - 1);
 
         if (value and value.back() == '\r')
             value = value.substr(0, value.len() - 1);
@@ -105,15 +109,6 @@ void wizchip_http_request_response_parse_headers_body(
         while (value and value.front() == ' ') 
             value = value.substr(1, value.len() - 1);
         
-        headers[std::string(key.data(), key.end())] = std::string(value.data(), value.end()); 
+        headers[std::string(key.data(), key.len())] = std::string(value.data(), value.len()); 
     }
-}
-
-Stream::InRule wizchip_http_request_response_string_to_stream_rule(
-    std::string str
-) {
-    return [str=etl::move(str)]() {
-        auto ptr = reinterpret_cast<const uint8_t*>(str.data());
-        return etl::iter(ptr, ptr + str.size());
-    };
 }
\ No newline at end of file
@@ -15,6 +15,7 @@ namespace Project::wizchip::http {
         std::string version;
         etl::UnorderedMap<std::string, std::string> headers;
         std::string body;
+        etl::UnorderedMap<std::string, std::string> params;    ///< path parameters captured by the server route.
     };
 }
 
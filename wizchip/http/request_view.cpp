@@ -0,0 +1,182 @@
+#include "wizchip/http/request_view.h"
+
+using namespace Project::wizchip;
+
+static auto trim(std::string_view sv) -> std::string_view {
+    while (not sv.empty() && (sv.front() == ' ' || sv.front() == '\t')) sv.remove_prefix(1);
+    while (not sv.empty() && (sv.back() == ' ' || sv.back() == '\t')) sv.remove_suffix(1);
+    return sv;
+}
+
+// line without its terminator, the terminator may be "\r\n" or "\n"
+static auto next_line(std::string_view& sv) -> std::string_view {
+    auto end = sv.find('\n');
+    auto line = sv.substr(0, end);
+    sv.remove_prefix(end == std::string_view::npos ? sv.size() : end + 1);
+    if (not line.empty() && line.back() == '\r') line.remove_suffix(1);
+    return line;
+}
+
+bool http::equals_ignore_case(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) 
+        return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (::tolower(a[i]) != ::tolower(b[i])) return false;
+    }
+    return true;
+}
+
+auto http::RequestView::parse(etl::Vector<uint8_t> buf) -> RequestView {
+    RequestView req;
+    req.buffer = etl::move(buf);
+    req.parse_in_place(req.buffer.data(), req.buffer.len());
+    return req;
+}
+
+auto http::RequestView::parse(uint8_t* bytes, size_t len) -> RequestView {
+    RequestView req;
+    req.parse_in_place(bytes, len);
+    return req;
+}
+
+void http::RequestView::parse_in_place(uint8_t* bytes, size_t len) {
+    auto& req = *this;
+    auto data = reinterpret_cast<char*>(bytes);
+    auto sv = std::string_view(data, len);
+
+    // the separator after a token is overwritten, so the token can be used as a C string
+    auto terminate = [&](std::string_view token) {
+        size_t end = token.data() + token.size() - data;
+        if (end < len) data[end] = '\0';
+    };
+
+    auto request_line = next_line(sv);
+    auto sp1 = request_line.find(' ');
+    auto sp2 = request_line.find(' ', sp1 == std::string_view::npos ? sp1 : sp1 + 1);
+    if (sp2 == std::string_view::npos)
+        return;
+
+    req.method = request_line.substr(0, sp1);
+    req.url = request_line.substr(sp1 + 1, sp2 - sp1 - 1);
+    req.version = request_line.substr(sp2 + 1);
+    terminate(req.method);
+    terminate(req.url);
+    terminate(req.version);
+
+    while (not sv.empty()) {
+        auto line = next_line(sv);
+        if (line.empty()) break;
+
+        auto colon = line.find(':');
+        if (colon == std::string_view::npos || req.header_count == max_headers) 
+            continue;
+        
+        auto& field = req.headers[req.header_count++];
+        field = {trim(line.substr(0, colon)), trim(line.substr(colon + 1))};
+        terminate(field.key);
+        terminate(field.value);
+    }
+    req.body = sv;
+
+    // absolute form targets carry the scheme and host before the path
+    auto target = req.url;
+    if (auto scheme = target.find("://"); scheme != std::string_view::npos) {
+        target.remove_prefix(scheme + 3);
+        auto slash = target.find('/');
+        target.remove_prefix(slash == std::string_view::npos ? target.size() : slash);
+    }
+
+    req.full_path = target.empty() ? "/" : target;
+    if (auto hash = target.find('#'); hash != std::string_view::npos) {
+        req.fragment = target.substr(hash + 1);
+        target = target.substr(0, hash);
+    }
+    if (auto question = target.find('?'); question != std::string_view::npos) {
+        req.query = target.substr(question + 1);
+        target = target.substr(0, question);
+    }
+    req.path = target.empty() ? "/" : target;
+}
+
+bool http::RequestView::has_header(std::string_view key) const {
+    for (size_t i = 0; i < header_count; ++i) {
+        if (equals_ignore_case(headers[i].key, key)) return true;
+    }
+    return false;
+}
+
+auto http::RequestView::header(std::string_view key) const -> std::string_view {
+    for (size_t i = 0; i < header_count; ++i) {
+        if (equals_ignore_case(headers[i].key, key)) return headers[i].value;
+    }
+    return {};
+}
+
+bool http::RequestView::has_query(std::string_view key) const {
+    for (auto sv = query; not sv.empty();) {
+        auto end = sv.find('&');
+        auto item = sv.substr(0, end);
+        sv.remove_prefix(end == std::string_view::npos ? sv.size() : end + 1);
+        if (item.substr(0, item.find('=')) == key) return true;
+    }
+    return false;
+}
+
+auto http::RequestView::query_value(std::string_view key) const -> std::string_view {
+    for (auto sv = query; not sv.empty();) {
+        auto end = sv.find('&');
+        auto item = sv.substr(0, end);
+        sv.remove_prefix(end == std::string_view::npos ? sv.size() : end + 1);
+
+        auto eq = item.find('=');
+        if (item.substr(0, eq) == key) {
+            return eq == std::string_view::npos ? std::string_view() : item.substr(eq + 1);
+        }
+    }
+    return {};
+}
+
+bool http::RequestView::has_param(std::string_view key) const {
+    for (size_t i = 0; i < param_count; ++i) {
+        if (params[i].key == key) return true;
+    }
+    return false;
+}
+
+auto http::RequestView::param(std::string_view key) const -> std::string_view {
+    for (size_t i = 0; i < param_count; ++i) {
+        if (params[i].key == key) return params[i].value;
+    }
+    return {};
+}
+
+auto http::RequestView::json() const -> const etl::Json& {
+    if (not json_doc) {
+        json_doc = etl::Json::parse(etl::StringView{body.data(), body.size()});
+    }
+    return *json_doc;
+}
+
+auto http::RequestView::request() const -> const Request& {
+    if (compat) 
+        return *compat;
+
+    Request req;
+    req.method = std::string(method);
+    req.path = URL(std::string(url));
+    req.version = std::string(version);
+    for (size_t i = 0; i < header_count; ++i) {
+        req.headers[std::string(headers[i].key)] = std::string(headers[i].value);
+    }
+    req.body = std::string(body);
+    for (size_t i = 0; i < param_count; ++i) {
+        req.params[std::string(params[i].key)] = std::string(params[i].value);
+    }
+
+    if (has_header("Host")) {
+        req.path.host = std::string(header("Host"));
+    }
+
+    compat = etl::move(req);
+    return *compat;
+}
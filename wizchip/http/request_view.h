@@ -0,0 +1,78 @@
+#ifndef WIZCHIP_HTTP_REQUEST_VIEW_H
+#define WIZCHIP_HTTP_REQUEST_VIEW_H
+
+#include "wizchip/http/request.h"
+#include "etl/json.h"
+#include <optional>
+#include <string_view>
+
+namespace Project::wizchip::http {
+    /// Request parsed in place, every field is a view into the receive buffer, owned by the view or by the caller.
+    /// Method, url, version and header fields are also null terminated in the buffer.
+    /// Not copyable, moving it keeps the views valid
+    struct RequestView {
+        static constexpr size_t max_headers = 24;
+        static constexpr size_t max_params = 8;
+
+        struct Field {
+            std::string_view key;
+            std::string_view value;
+        };
+
+        static RequestView parse(etl::Vector<uint8_t> buf);
+        /// parse bytes owned by the caller, e.g. a request arena, they must outlive the view
+        static RequestView parse(uint8_t* data, size_t len);
+
+        RequestView() = default;
+        RequestView(RequestView&&) = default;
+        RequestView& operator=(RequestView&&) = default;
+        RequestView(const RequestView&) = delete;
+        RequestView& operator=(const RequestView&) = delete;
+
+        std::string_view method;
+        std::string_view url;           ///< request target as sent.
+        std::string_view path;          ///< target without query and fragment.
+        std::string_view full_path;     ///< target from the path on, with query and fragment.
+        std::string_view query;         ///< raw query string, without '?'.
+        std::string_view fragment;
+        std::string_view version;
+        std::string_view body;          ///< received part of the body.
+
+        Field headers[max_headers] = {};
+        size_t header_count = 0;
+
+        Field params[max_params] = {};  ///< path parameters captured by the server route.
+        size_t param_count = 0;
+
+        /// header lookup, case insensitive
+        bool has_header(std::string_view key) const;
+        std::string_view header(std::string_view key) const;
+
+        /// raw query value, still percent encoded
+        bool has_query(std::string_view key) const;
+        std::string_view query_value(std::string_view key) const;
+
+        bool has_param(std::string_view key) const;
+        std::string_view param(std::string_view key) const;
+
+        /// body parsed as JSON, parsed once on first use and shared by every arg
+        const etl::Json& json() const;
+
+        /// owning copy of the request, built once on first use
+        const Request& request() const;
+        operator const Request&() const { return request(); }
+
+        etl::Vector<uint8_t> buffer;    ///< empty when the bytes are owned by the caller.
+
+    private:
+        void parse_in_place(uint8_t* data, size_t len);
+
+        mutable std::optional<Request> compat;
+        mutable std::optional<etl::Json> json_doc;
+    };
+
+    /// ASCII comparison, as used for header names and tokens
+    bool equals_ignore_case(std::string_view a, std::string_view b);
+}
+
+#endif
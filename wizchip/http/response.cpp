@@ -1,6 +1,9 @@
 #include "response.h"
 #include "etl/this_thread.h"
+#include "etl/heap.h"
 #include "etl/keywords.h"
+#include <cstdio>
+#include <cstring>
 
 using namespace wizchip;
 
@@ -10,10 +13,6 @@ void wizchip_http_request_response_parse_headers_body(
     std::string& body
 );
 
-Stream::InRule wizchip_http_request_response_string_to_stream_rule(
-    std::string str
-);
-
 auto http::Response::parse(etl::Vector<uint8_t> buf) -> Response {
     auto sv = etl::string_view(buf.data(), buf.len());
     auto methods = sv.split<3>(" ");
@@ -38,29 +37,240 @@ auto http::Response::parse(etl::Vector<uint8_t> buf) -> Response {
     return res;
 }
 
+static constexpr size_t chunk_head = 18;    // 16 hex digits and CRLF
+
+// pulls the generator one chunk at a time into buf, with room for the chunk size line and CRLF around the data
+static auto chunked_body(http::Response::Generator generator, etl::Vector<uint8_t> buf, size_t chunk_size, bool framed) -> Stream::Generator {
+    static const uint8_t last_chunk[] = {'0', '\r', '\n', '\r', '\n'};
+    
+    return {[generator=etl::move(generator), buf=etl::move(buf), chunk_size, framed, done=false]() mutable -> etl::Iter<const uint8_t*> {
+        const uint8_t* end = buf.data();
+        if (done) 
+            return etl::iter(end, end);
+
+        auto data = buf.data() + (framed ? chunk_head : 0);
+        auto n = etl::min(generator(data, chunk_size), chunk_size);
+        if (not framed) {
+            done = n == 0;
+            const uint8_t* begin = data;
+            return etl::iter(begin, begin + n);
+        }
+
+        if (n == 0) {
+            done = true;
+            return etl::iter(last_chunk);
+        }
+
+        char hex[chunk_head];
+        int len = ::snprintf(hex, sizeof(hex), "%zx", n);
+        auto start = data - len - 2;
+        ::memcpy(start, hex, len);
+        start[len] = '\r';
+        start[len + 1] = '\n';
+        data[n] = '\r';
+        data[n + 1] = '\n';
+        const uint8_t* begin = start;
+        return etl::iter(begin, begin + len + 2 + n + 2);
+    }};
+}
+
+struct StatusEntry {
+    int status;
+    const char* reason;
+    const char* line;       ///< pre-rendered HTTP/1.1 status line.
+};
+
+#define WIZCHIP_HTTP_STATUS(status, reason) StatusEntry{status, reason, "HTTP/1.1 " #status " " reason "\r\n"}
+
+// sorted by status
+static constexpr StatusEntry status_table[] = {
+    WIZCHIP_HTTP_STATUS(100, "Continue"), // RFC 9110, 15.2.1
+    WIZCHIP_HTTP_STATUS(101, "Switching Protocols"), // RFC 9110, 15.2.2
+    WIZCHIP_HTTP_STATUS(102, "Processing"), // RFC 2518, 10.1
+    WIZCHIP_HTTP_STATUS(103, "EarlyHints"), // RFC 8297
+
+    WIZCHIP_HTTP_STATUS(200, "OK"), // RFC 9110, 15.3.1
+    WIZCHIP_HTTP_STATUS(201, "Created"), // RFC 9110, 15.3.2
+    WIZCHIP_HTTP_STATUS(202, "Accepted"), // RFC 9110, 15.3.3
+    WIZCHIP_HTTP_STATUS(203, "Non Authoritative Info"), // RFC 9110, 15.3.4
+    WIZCHIP_HTTP_STATUS(204, "No Content"), // RFC 9110, 15.3.5
+    WIZCHIP_HTTP_STATUS(205, "Reset Content"), // RFC 9110, 15.3.6
+    WIZCHIP_HTTP_STATUS(206, "Partial Content"), // RFC 9110, 15.3.7
+    WIZCHIP_HTTP_STATUS(207, "Multi Status"), // RFC 4918, 11.1
+    WIZCHIP_HTTP_STATUS(208, "Already Reported"), // RFC 5842, 7.1
+    WIZCHIP_HTTP_STATUS(226, "IM Used"), // RFC 3229, 10.4.1
+
+    WIZCHIP_HTTP_STATUS(300, "Multiple Choices"), // RFC 9110, 15.4.1
+    WIZCHIP_HTTP_STATUS(301, "Moved Permanently"), // RFC 9110, 15.4.2
+    WIZCHIP_HTTP_STATUS(302, "Found"), // RFC 9110, 15.4.3
+    WIZCHIP_HTTP_STATUS(303, "See Other"), // RFC 9110, 15.4.4
+    WIZCHIP_HTTP_STATUS(304, "Not Modified"), // RFC 9110, 15.4.5
+    WIZCHIP_HTTP_STATUS(305, "Use Proxy"), // RFC 9110, 15.4.6
+    WIZCHIP_HTTP_STATUS(307, "Temporary Redirect"), // RFC 9110, 15.4.8
+    WIZCHIP_HTTP_STATUS(308, "Permanent Redirect"), // RFC 9110, 15.4.9
+
+    WIZCHIP_HTTP_STATUS(400, "Bad Request"), // RFC 9110, 15.5.1
+    WIZCHIP_HTTP_STATUS(401, "Unauthorized"), // RFC 9110, 15.5.2
+    WIZCHIP_HTTP_STATUS(402, "Payment Required"), // RFC 9110, 15.5.3
+    WIZCHIP_HTTP_STATUS(403, "Forbidden"), // RFC 9110, 15.5.4
+    WIZCHIP_HTTP_STATUS(404, "Not Found"), // RFC 9110, 15.5.5
+    WIZCHIP_HTTP_STATUS(405, "Method Not Allowed"), // RFC 9110, 15.5.6
+    WIZCHIP_HTTP_STATUS(406, "Not Acceptable"), // RFC 9110, 15.5.7
+    WIZCHIP_HTTP_STATUS(407, "Proxy AuthRequired"), // RFC 9110, 15.5.8
+    WIZCHIP_HTTP_STATUS(408, "Request Timeout"), // RFC 9110, 15.5.9
+    WIZCHIP_HTTP_STATUS(409, "Conflict"), // RFC 9110, 15.5.10
+    WIZCHIP_HTTP_STATUS(410, "Gone"), // RFC 9110, 15.5.11
+    WIZCHIP_HTTP_STATUS(411, "Length Required"), // RFC 9110, 15.5.12
+    WIZCHIP_HTTP_STATUS(412, "Precondition Failed"), // RFC 9110, 15.5.13
+    WIZCHIP_HTTP_STATUS(413, "Request Entity TooLarge"), // RFC 9110, 15.5.14
+    WIZCHIP_HTTP_STATUS(414, "Request URI TooLong"), // RFC 9110, 15.5.15
+    WIZCHIP_HTTP_STATUS(415, "Unsupported Media Type"), // RFC 9110, 15.5.16
+    WIZCHIP_HTTP_STATUS(416, "Requested Range Not Satisfiable"), // RFC 9110, 15.5.17
+    WIZCHIP_HTTP_STATUS(417, "Expectation Failed"), // RFC 9110, 15.5.18
+    WIZCHIP_HTTP_STATUS(418, "Teapot"), // RFC 9110, 15.5.19 (Unused)
+    WIZCHIP_HTTP_STATUS(421, "Misdirected Request"), // RFC 9110, 15.5.20
+    WIZCHIP_HTTP_STATUS(422, "Unprocessable Entity"), // RFC 9110, 15.5.21
+    WIZCHIP_HTTP_STATUS(423, "Locked"), // RFC 4918, 11.3
+    WIZCHIP_HTTP_STATUS(424, "Failed Dependency"), // RFC 4918, 11.4
+    WIZCHIP_HTTP_STATUS(425, "Too Early"), // RFC 8470, 5.2.
+    WIZCHIP_HTTP_STATUS(426, "Upgrade Required"), // RFC 9110, 15.5.22
+    WIZCHIP_HTTP_STATUS(428, "Precondition Required"), // RFC 6585, 3
+    WIZCHIP_HTTP_STATUS(429, "Too Many Requests"), // RFC 6585, 4
+    WIZCHIP_HTTP_STATUS(431, "Request Header Fields TooLarge"), // RFC 6585, 5
+    WIZCHIP_HTTP_STATUS(451, "Unavailable For Legal Reasons"), // RFC 7725, 3
+
+    WIZCHIP_HTTP_STATUS(500, "Internal Server Error"), // RFC 9110, 15.6.1
+    WIZCHIP_HTTP_STATUS(501, "Not Implemented"), // RFC 9110, 15.6.2
+    WIZCHIP_HTTP_STATUS(502, "Bad Gateway"), // RFC 9110, 15.6.3
+    WIZCHIP_HTTP_STATUS(503, "Service Unavailable"), // RFC 9110, 15.6.4
+    WIZCHIP_HTTP_STATUS(504, "Gateway Timeout"), // RFC 9110, 15.6.5
+    WIZCHIP_HTTP_STATUS(505, "HTTP Version Not Supported"), // RFC 9110, 15.6.6
+    WIZCHIP_HTTP_STATUS(506, "Variant Also Negotiates"), // RFC 2295, 8.1
+    WIZCHIP_HTTP_STATUS(507, "Insufficient Storage"), // RFC 4918, 11.5
+    WIZCHIP_HTTP_STATUS(508, "Loop Detected"), // RFC 5842, 7.2
+    WIZCHIP_HTTP_STATUS(510, "Not Extended"), // RFC 2774, 7
+    WIZCHIP_HTTP_STATUS(511, "Network Authentication Required"), // RFC 6585, 6
+};
+
+#undef WIZCHIP_HTTP_STATUS
+
+static auto find_status(int status) -> const StatusEntry* {
+    size_t lo = 0, hi = sizeof(status_table) / sizeof(status_table[0]);
+    while (lo < hi) {
+        auto mid = (lo + hi) / 2;
+        if (status_table[mid].status < status) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo < sizeof(status_table) / sizeof(status_table[0]) && status_table[lo].status == status ? &status_table[lo] : nullptr;
+}
+
+auto http::status_text(int status) -> const char* {
+    auto entry = find_status(status);
+    return entry ? entry->reason : "Unknown";
+}
+
+// decimal digits written in place, returns the end
+static char* write_int(char* ptr, int value) {
+    char digits[12];
+    int n = 0;
+    unsigned int v = value < 0 ? -unsigned(value) : value;
+    do {
+        digits[n++] = '0' + v % 10;
+        v /= 10;
+    } while (v > 0);
+    if (value < 0) *ptr++ = '-';
+    while (n > 0) *ptr++ = digits[--n];
+    return ptr;
+}
+
+static char* write_str(char* ptr, std::string_view str) {
+    ::memcpy(ptr, str.data(), str.size());
+    return ptr + str.size();
+}
+
 auto http::Response::dump() -> Stream {
-    static const uint8_t space[] = {' '};
-    static const uint8_t cr_lf[] = {'\r', '\n'};
-    static const uint8_t colon[] = {':', ' '};
+    return dump(nullptr);
+}
 
-    Stream s;
-    s << wizchip_http_request_response_string_to_stream_rule(mv | version);
-    s << etl::iter(space);
-    s << wizchip_http_request_response_string_to_stream_rule(std::to_string(status));
-    s << etl::iter(space);
-    s << wizchip_http_request_response_string_to_stream_rule(mv | status_string);
-    s << etl::iter(cr_lf);
+auto http::Response::dump(Arena& arena) -> Stream {
+    return dump(&arena);
+}
+
+auto http::Response::dump(Arena* arena) -> Stream {
+    // HTTP/1.0 has no chunked encoding, the body ends when the connection closes
+    bool framed = version != "HTTP/1.0";
+
+    // the chunk buffer is taken before the head is written, without it the response becomes a 500
+    etl::Vector<uint8_t> chunk_buf;
+    if (generator) {
+        size_t len = chunk_head + chunk_size + 2;
+        if (etl::heap::freeSize >= len) chunk_buf = etl::vector_allocate<uint8_t>(len);
+        if (chunk_buf.len() == 0) {
+            generator = {};
+            status = StatusInternalServerError;
+            status_string.clear();
+            headers["Content-Length"] = "0";
+        }
+    }
+    if (generator && framed) {
+        headers["Transfer-Encoding"] = "chunked";
+    }
+
+    // the status line comes pre-rendered unless the version or the reason are custom
+    auto entry = find_status(status);
+    const char* line = entry && version == "HTTP/1.1" && (status_string.empty() || status_string == entry->reason) ? entry->line : nullptr;
+    std::string_view reason = not status_string.empty() ? std::string_view(status_string) : entry ? entry->reason : "Unknown";
+
+    size_t size = line ? ::strlen(line) : version.size() + reason.size() + 16;
+    for (auto &[key, value] : headers) {
+        size += key.size() + value.size() + 4;
+    }
+    size += 2;
+
+    // the whole head is written into one buffer, taken from the arena when there is room
+    std::string head;
+    auto buf = arena ? static_cast<char*>(arena->allocate(size, 1)) : nullptr;
+    if (buf == nullptr) {
+        head.resize(size);
+        buf = head.data();
+    }
+
+    auto ptr = buf;
+    if (line) {
+        ptr = write_str(ptr, line);
+    } else {
+        ptr = write_str(ptr, version);
+        *ptr++ = ' ';
+        ptr = write_int(ptr, status);
+        *ptr++ = ' ';
+        ptr = write_str(ptr, reason);
+        ptr = write_str(ptr, "\r\n");
+    }
     
     for (auto &[key, value] : headers) {
-        s << wizchip_http_request_response_string_to_stream_rule(mv | key);
-        s << etl::iter(colon);
-        s << wizchip_http_request_response_string_to_stream_rule(mv | value);
-        s << etl::iter(cr_lf);
+        ptr = write_str(ptr, key);
+        ptr = write_str(ptr, ": ");
+        ptr = write_str(ptr, value);
+        ptr = write_str(ptr, "\r\n");
+    }
+    ptr = write_str(ptr, "\r\n");
+
+    Stream s;
+    if (head.empty()) {
+        auto begin = reinterpret_cast<const uint8_t*>(buf);
+        s << etl::iter(begin, begin + (ptr - buf));
+    } else {
+        head.resize(ptr - buf);
+        s << etl::move(head);
     }
 
-    s << etl::iter(cr_lf);
-    if (!body.empty()) {
-        s << wizchip_http_request_response_string_to_stream_rule(mv | body);
+    if (generator) {
+        s << chunked_body(etl::move(generator), etl::move(chunk_buf), chunk_size, framed);
+    } else if (!body_ref.empty()) {
+        auto ptr = reinterpret_cast<const uint8_t*>(body_ref.data());
+        s << etl::iter(ptr, ptr + body_ref.size());
+    } else if (!body.empty()) {
+        s << etl::move(body);
     }
 
     return s;
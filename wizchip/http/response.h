@@ -2,21 +2,35 @@
 #define WIZCHIP_HTTP_RESPONSE_H
 
 #include "wizchip/stream.h"
+#include "wizchip/http/arena.h"
 #include <etl/vector.h>
 #include <etl/unordered_map.h>
 #include <etl/string_view.h>
 #include <string>
+#include <string_view>
 
 namespace Project::wizchip::http {
     struct Response {
         static Response parse(etl::Vector<uint8_t> buf);
         Stream dump();
+        /// the head is written into the arena, the stream has to be sent before the arena is reset
+        Stream dump(Arena& arena);
 
         std::string version;
         int status;
-        std::string status_string;
+        std::string status_string;          ///< custom reason phrase, the standard one is used when empty.
         etl::UnorderedMap<std::string, std::string> headers;
         std::string body;
+        std::string_view body_ref = {};     ///< body sent without a copy instead of body, it must outlive the response.
+
+        /// fills buf with the next part of the body, returns the bytes written, 0 at the end
+        using Generator = std::function<size_t(uint8_t* buf, size_t len)>;
+
+        Generator generator = {};   ///< body streamed with chunked encoding instead of body, HTTP/1.0 gets it raw.
+        size_t chunk_size = 512;    ///< largest chunk of the generator, the only buffer of a streamed body.
+
+    private:
+        Stream dump(Arena* arena);
     };
 
     enum Status : int {
@@ -87,6 +101,9 @@ namespace Project::wizchip::http {
         StatusNotExtended                   = 510, // RFC 2774, 7
         StatusNetworkAuthenticationRequired = 511, // RFC 6585, 6
     };
+
+    /// reason phrase of a status, "Unknown" when it is not listed
+    const char* status_text(int status);
 }
 
 #endif
\ No newline at end of file
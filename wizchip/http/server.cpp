@@ -5,61 +5,193 @@
 using namespace Project;
 using namespace Project::wizchip;
 
-static auto status_to_string(int status) -> std::string;
-
 auto http::Server::response(int socket_number, etl::Vector<uint8_t> data) -> Stream {
-    auto start_time = etl::time::now();
-    auto response = Response {};
-    auto request = Request::parse(etl::move(data));
+    auto& session = sessions[socket_number];
 
-    int len = 0;
-    if (request.headers.has("Content-Length")) {
-        len = etl::string_view(request.headers["Content-Length"].c_str()).to_int() - request.body.size();
-    } else if (request.headers.has("content-length")) {
-        len = etl::string_view(request.headers["content-length"].c_str()).to_int() - request.body.size();
+    // continue the incomplete request left by the previous receive
+    if (session.pending.len() > 0) {
+        auto size = session.pending.len() + data.len();
+        if (etl::heap::freeSize < size) {
+            session.pending = etl::Vector<uint8_t>();
+            session.close = true;
+            return Stream();
+        }
+
+        auto joined = etl::vector_allocate<uint8_t>(size);
+        ::memcpy(joined.data(), session.pending.data(), session.pending.len());
+        ::memcpy(joined.data() + session.pending.len(), data.data(), data.len());
+        session.pending = etl::Vector<uint8_t>();
+        data = etl::move(joined);
     }
 
-    bool no_memory = false;
-    if (int(etl::heap::freeSize) < len) {
-        no_memory = true;
-    } else if (len > 0) {
-        auto body_size = response.body.size();
-        request.body.resize(body_size + len);
-        detail::tcp_receive_to(socket_number, reinterpret_cast<uint8_t*>(&request.body[body_size]), len);
-    } else if (len < 0) {
-        request.body.resize(request.body.size() + len);
+    const auto ptr = data.data();
+    const size_t total = data.len();
+
+    Stream res;
+    for (size_t offset = 0; offset < total && not session.close;) {
+        // bytes of the pending part were fed on the previous receive
+        auto& parser = session.parser;
+        session.parsed += parser.feed(ptr + offset + session.parsed, total - offset - session.parsed);
+
+        if (parser.failed() || (parser.done() && parser.chunked)) {
+            auto response = Response {"HTTP/1.1", parser.failed() ? StatusBadRequest : StatusLengthRequired};
+            if (parser.error == Parser::Error::TooManyHeaders || parser.error == Parser::Error::HeaderTooLarge) {
+                response.status = StatusRequestHeaderFieldsTooLarge;
+            }
+            response.headers["Connection"] = "close";
+            response.headers["Content-Length"] = "0";
+            session.close = true;
+            if (not res.empty()) {
+                detail::tcp_send(socket_number, res);
+            }
+            res = response.dump();
+            break;
+        }
+
+        if (not parser.done()) {
+            session.pending = etl::vector_allocate<uint8_t>(total - offset);
+            ::memcpy(session.pending.data(), ptr + offset, total - offset);
+            break;
+        }
+
+        // a body that goes past this receive can only belong to the last request, the rest of it is read here
+        auto request_len = parser.body_start + parser.content_length;
+        auto len = etl::min(request_len, total - offset);
+        parser.reset();
+        session.parsed = 0;
+
+        // responses of pipelined requests go out in order, the last one is sent by the caller
+        if (not res.empty()) {
+            detail::tcp_send(socket_number, res);
+        }
+
+        // the previous response is out, everything it took from the arena is released at once
+        if (session.arena.capacity() != arena_size && arena_size > 0 && etl::heap::freeSize >= arena_size) {
+            session.arena = Arena(arena_size);
+        }
+        session.arena.reset();
+
+        // the rest of the body is read straight from the socket, false when it did not all come
+        auto receive_rest = [&](uint8_t* buf) {
+            return len == request_len || 
+                detail::tcp_receive_to(socket_number, buf + len, request_len - len, body_timeout_ms) == request_len - len;
+        };
+
+        RequestView request;
+        bool no_memory = false;
+        bool timed_out = false;
+        if (auto mem = static_cast<uint8_t*>(session.arena.allocate(request_len, 1))) {
+            ::memcpy(mem, ptr + offset, len);
+            timed_out = not receive_rest(mem);
+            if (not timed_out) request = RequestView::parse(mem, request_len);
+        } else if (len == request_len && len == total) {
+            request = RequestView::parse(etl::move(data));
+        } else if (etl::heap::freeSize >= request_len) {
+            // the buffer is allocated once for the whole body
+            auto buf = etl::vector_allocate<uint8_t>(request_len);
+            ::memcpy(buf.data(), ptr + offset, len);
+            timed_out = not receive_rest(buf.data());
+            if (not timed_out) request = RequestView::parse(etl::move(buf));
+        } else {
+            auto buf = etl::vector_allocate<uint8_t>(len);
+            ::memcpy(buf.data(), ptr + offset, len);
+            request = RequestView::parse(etl::move(buf));
+            no_memory = true;
+        }
+        offset += len;
+
+        // the connection is out of step with the requests once a body is cut short
+        if (timed_out) {
+            auto response = Response {"HTTP/1.1", StatusRequestTimeout};
+            response.headers["Connection"] = "close";
+            response.headers["Content-Length"] = "0";
+            session.close = true;
+            res = response.dump();
+            break;
+        }
+
+        res = process(socket_number, etl::move(request), no_memory);
     }
 
+    return res;
+}
+
+auto http::Server::process(int socket_number, RequestView&& request, bool no_memory) -> Stream {
+    auto start_time = etl::time::now();
+    auto response = Response {};
+    auto& session = sessions[socket_number];
+
+    size_t heap_free = etl::heap::freeSize;
+    if (heap_free < heap_low_water) heap_low_water = heap_free;
+
     // TODO: version handling
-    response.version = request.version;
+    response.version = std::string(request.version);
+    response.chunk_size = chunk_size;
 
     // router handling
     if (no_memory) {
         response.status = StatusInternalServerError;
     } else {
-        bool handled = false;
-        for (auto &router : routers) {
-            if (router.path == request.path.path) {
-                auto it = etl::find(router.methods, request.method);
-                if (it == router.methods.end()) {
-                    response.status = StatusMethodNotAllowed;
-                } else {
-                    response.status = StatusOK;
-                    router.function(request, response);
-                }
-                handled = true;
-                break;
+        std::string_view values[max_path_params];
+        auto route = find_route(request.path, values);
+        auto method = method_mask(request.method);
+
+        auto router = route;
+        while (router && not (router->methods & method)) {
+            router = router->next;
+        }
+
+        if (router) {
+            request.param_count = router->params.len();
+            for (size_t i = 0; i < request.param_count; ++i) {
+                request.params[i] = {router->params[i], values[i]};
             }
+            response.status = StatusOK;
+            router->function(request, response);
+        } else if (route) {
+            uint16_t allowed = 0;
+            for (auto r = route; r; r = r->next) allowed |= r->methods;
+            response.status = StatusMethodNotAllowed;
+            response.headers["Allow"] = allow_header(allowed);
+        } else if (not serve_asset(request, response)) {
+            response.status = StatusNotFound;
         }
-    
-        if (not handled) response.status = StatusNotFound;
+    }
+
+    // HTTP/1.1 connections persist unless closed by either side, HTTP/1.0 ones only when asked for
+    session.requests++;
+    auto connection = request.header("Connection");
+
+    bool keep = keep_alive.enabled && not no_memory;
+    if (request.version == "HTTP/1.0") {
+        keep = keep && equals_ignore_case(connection, "keep-alive");
+    } else {
+        keep = keep && not equals_ignore_case(connection, "close");
+    }
+    if (keep_alive.max_requests > 0 && session.requests >= keep_alive.max_requests) {
+        keep = false;
+    }
+    if (response.generator && request.version == "HTTP/1.0") {
+        // a raw streamed body is only delimited by closing the connection
+        keep = false;
     }
 
     // generate payload
-    if (response.status_string.empty()) response.status_string = status_to_string(response.status);
-    if (not response.body.empty()) response.headers["Content-Length"] = std::to_string(response.body.size());
+    if (not response.generator && (not response.body.empty() || not response.body_ref.empty() || not response.headers.has("Content-Length"))) {
+        // the length frames the response on a persistent connection, even when there is no body
+        if (response.status >= 200 && response.status != StatusNoContent && response.status != StatusNotModified) {
+            response.headers["Content-Length"] = std::to_string(response.body_ref.empty() ? response.body.size() : response.body_ref.size());
+        }
+    }
     if (name) response.headers["Server"] = name;
 
+    if (not keep) {
+        session.close = true;
+        response.headers["Connection"] = "close";
+    } else if (request.version == "HTTP/1.0") {
+        response.headers["Connection"] = "keep-alive";
+    }
+
     for (auto &[header, fn] : global_headers) {
         auto head = fn(request, response);
         if (not head.empty()) response.headers[header] = etl::move(head);
@@ -67,82 +199,244 @@ auto http::Server::response(int socket_number, etl::Vector<uint8_t> data) -> Str
 
     if (show_response_time) response.headers["X-Response-Time"] = std::to_string(etl::time::elapsed(start_time).tick) + "ms";
     if (logger) logger(request, response);
+    return response.dump(session.arena);
+}
+
+void http::Server::serve_static(std::string prefix, AssetProvider provider) {
+    if (prefix.empty() || prefix.back() != '/') prefix += '/';
+    static_mounts.push(StaticMount{etl::move(prefix), etl::move(provider)});
+}
+
+// gzip is listed in Accept-Encoding and not refused with q=0
+static bool accepts_gzip(std::string_view accept_encoding) {
+    for (auto sv = accept_encoding; not sv.empty();) {
+        auto end = sv.find(',');
+        auto item = sv.substr(0, end);
+        sv.remove_prefix(end == std::string_view::npos ? sv.size() : end + 1);
+
+        while (not item.empty() && item.front() == ' ') item.remove_prefix(1);
+        auto semicolon = item.find(';');
+        auto coding = item.substr(0, semicolon);
+        while (not coding.empty() && coding.back() == ' ') coding.remove_suffix(1);
+        if (not http::equals_ignore_case(coding, "gzip") && coding != "*") 
+            continue;
+
+        auto params = semicolon == std::string_view::npos ? std::string_view() : item.substr(semicolon + 1);
+        auto q = params.find("q=");
+        if (q == std::string_view::npos) 
+            return true;
+        
+        // q=0, q=0.0 and q=0.000 refuse it
+        for (auto ch : params.substr(q + 2)) {
+            if (ch >= '1' && ch <= '9') return true;
+            if (ch != '0' && ch != '.') break;
+        }
+        return false;
+    }
+    return false;
+}
+
+bool http::Server::serve_asset(const RequestView& request, Response& response) {
+    for (auto& mount : static_mounts) {
+        auto path = request.path;
+        auto prefix = std::string_view(mount.prefix);
+        if (path.size() + 1 == prefix.size() && prefix.substr(0, path.size()) == path) {
+            path = "";
+        } else if (path.substr(0, prefix.size()) == prefix) {
+            path.remove_prefix(prefix.size());
+        } else {
+            continue;
+        }
+
+        const Asset* asset = nullptr;
+        if (path.empty() || path.back() == '/') {
+            auto index = std::string(path) + "index.html";
+            asset = mount.provider(index);
+        } else {
+            asset = mount.provider(path);
+        }
+        if (asset == nullptr) 
+            continue;
+
+        auto method = method_mask(request.method);
+        if (not (method & (MethodGet | MethodHead))) {
+            response.status = StatusMethodNotAllowed;
+            response.headers["Allow"] = allow_header(MethodGet | MethodHead);
+            return true;
+        }
+
+        if (asset->gzip_data) response.headers["Vary"] = "Accept-Encoding";
+        if (asset->etag) {
+            response.headers["ETag"] = asset->etag;
+            response.headers["Cache-Control"] = "no-cache";
+
+            auto if_none_match = request.header("If-None-Match");
+            if (if_none_match == "*" || if_none_match.find(asset->etag) != std::string_view::npos) {
+                response.status = StatusNotModified;
+                return true;
+            }
+        }
+
+        bool gzip = asset->gzip_data && accepts_gzip(request.header("Accept-Encoding"));
+        auto data = gzip ? asset->gzip_data : asset->data;
+        auto size = gzip ? asset->gzip_size : asset->size;
+
+        response.status = StatusOK;
+        response.headers["Content-Type"] = asset->content_type;
+        if (gzip) response.headers["Content-Encoding"] = "gzip";
+
+        // sent straight from read-only memory, HEAD only gets the length
+        if (method == MethodHead) {
+            response.headers["Content-Length"] = std::to_string(size);
+        } else {
+            response.body_ref = std::string_view(reinterpret_cast<const char*>(data), size);
+        }
+        return true;
+    }
+    return false;
+}
+
+// in the bit order of Method
+static constexpr std::string_view method_names[] = {"GET", "HEAD", "POST", "PUT", "DELETE", "CONNECT", "OPTIONS", "TRACE", "PATCH"};
+
+uint16_t http::Server::method_mask(std::string_view method) {
+    for (size_t i = 0; i < sizeof(method_names) / sizeof(method_names[0]); ++i) {
+        if (equals_ignore_case(method, method_names[i])) return 1 << i;
+    }
+    return 0;
+}
+
+std::string http::Server::allow_header(uint16_t methods) {
+    std::string res;
+    for (size_t i = 0; i < sizeof(method_names) / sizeof(method_names[0]); ++i) {
+        if (not (methods & (1 << i))) 
+            continue;
+        if (not res.empty()) res += ", ";
+        res += method_names[i];
+    }
+    return res;
+}
+
+// next segment of the path, the leading slash is skipped
+static auto next_segment(std::string_view& path) -> std::string_view {
+    if (not path.empty() && path.front() == '/') path.remove_prefix(1);
+    auto end = path.find('/');
+    auto res = path.substr(0, end);
+    path.remove_prefix(end == std::string_view::npos ? path.size() : end);
+    return res;
+}
+
+void http::Server::add_route(Router& router) {
+    auto new_node = [this](std::string segment, bool is_param) {
+        route_nodes.push(RouteNode{etl::move(segment), is_param, nullptr, nullptr, nullptr});
+        return &route_nodes.back();
+    };
+
+    if (route_root == nullptr) {
+        route_root = new_node("", false);
+    }
+
+    auto node = route_root;
+    for (std::string_view path = router.path; not path.empty();) {
+        auto segment = next_segment(path);
+        if (segment.empty()) 
+            continue;
+
+        bool is_param = segment.size() >= 2 && segment.front() == '{' && segment.back() == '}';
+        if (is_param) {
+            router.params.append(std::string(segment.substr(1, segment.size() - 2)));
+            segment = "";
+        }
+
+        RouteNode* prev = nullptr;
+        auto child = node->child;
+        while (child && not (child->is_param == is_param && child->segment == segment)) {
+            prev = child;
+            child = child->sibling;
+        }
+
+        if (child == nullptr) {
+            // literals go first so they are preferred, the parameter of this depth goes last
+            child = new_node(std::string(segment), is_param);
+            if (is_param && prev) {
+                prev->sibling = child;
+            } else if (is_param) {
+                node->child = child;
+            } else {
+                child->sibling = node->child;
+                node->child = child;
+            }
+        }
+        node = child;
+    }
+
+    // keep the registration order of routes on the same path
+    auto last = &node->router;
+    while (*last) last = &(*last)->next;
+    *last = &router;
+}
+
+auto http::Server::find_route(std::string_view path, std::string_view (&values)[max_path_params]) -> Router* {
+    if (route_root == nullptr) 
+        return nullptr;
+    return match_route(route_root, path, values, 0);
+}
+
+auto http::Server::match_route(RouteNode* node, std::string_view path, std::string_view (&values)[max_path_params], size_t depth) -> Router* {
+    if (path.empty() || path == "/") 
+        return node->router;
+
+    auto rest = path;
+    auto segment = next_segment(rest);
+
+    for (auto child = node->child; child; child = child->sibling) {
+        if (child->is_param) {
+            if (segment.empty() || depth >= max_path_params) 
+                continue;
+            values[depth] = segment;
+            if (auto res = match_route(child, rest, values, depth + 1)) return res;
+        } else if (child->segment == segment) {
+            if (auto res = match_route(child, rest, values, depth)) return res;
+        }
+    }
+
+    return nullptr;
+}
+
+int http::Server::on_closed(int socket_number) {
+    if (not connections[socket_number].busy) {
+        auto& session = sessions[socket_number];
+        session.requests = 0;
+        session.close = false;
+        session.pending = etl::Vector<uint8_t>();
+        session.parser = Parser(limits);
+        session.parsed = 0;
+    }
+    return tcp::Server::on_closed(socket_number);
+}
+
+auto http::Server::memory_stats() const -> MemoryStats {
+    MemoryStats stats = {};
+    stats.arena_size = arena_size;
+    for (auto& session : sessions) {
+        stats.arena_high_water = etl::max(stats.arena_high_water, session.arena.high_water);
+        stats.arena_overflows += session.arena.overflows;
+    }
+    stats.heap_free = etl::heap::freeSize;
+    stats.heap_low_water = etl::min(size_t(heap_low_water), stats.heap_free);
+    return stats;
+}
+
+auto http::Server::overload_response(int socket_number) -> Stream {
+    auto response = Response {"HTTP/1.1", StatusServiceUnavailable};
+    response.headers["Retry-After"] = "1";
+    response.headers["Connection"] = "close";
+    response.headers["Content-Length"] = "0";
+    if (name) response.headers["Server"] = name;
+    sessions[socket_number].close = true;
     return response.dump();
 }
 
-static auto status_to_string(int status) -> std::string {
-    switch (status) {
-        // 100
-        case http::StatusContinue           : return "Continue"; // RFC 9110, 15.2.1
-        case http::StatusSwitchingProtocols : return "Switching Protocols"; // RFC 9110, 15.2.2
-        case http::StatusProcessing         : return "Processing"; // RFC 2518, 10.1
-        case http::StatusEarlyHints         : return "EarlyHints"; // RFC 8297
-
-        // 200
-        case http::StatusOK                   : return "OK"; // RFC 9110, 15.3.1
-        case http::StatusCreated              : return "Created"; // RFC 9110, 15.3.2
-        case http::StatusAccepted             : return "Accepted"; // RFC 9110, 15.3.3
-        case http::StatusNonAuthoritativeInfo : return "Non Authoritative Info"; // RFC 9110, 15.3.4
-        case http::StatusNoContent            : return "No Content"; // RFC 9110, 15.3.5
-        case http::StatusResetContent         : return "Reset Content"; // RFC 9110, 15.3.6
-        case http::StatusPartialContent       : return "Partial Content"; // RFC 9110, 15.3.7
-        case http::StatusMultiStatus          : return "Multi Status"; // RFC 4918, 11.1
-        case http::StatusAlreadyReported      : return "Already Reported"; // RFC 5842, 7.1
-        case http::StatusIMUsed               : return "IM Used"; // RFC 3229, 10.4.1
-
-        // 300
-        case http::StatusMultipleChoices   : return "Multiple Choices"; // RFC 9110, 15.4.1
-        case http::StatusMovedPermanently  : return "Moved Permanently"; // RFC 9110, 15.4.2
-        case http::StatusFound             : return "Found"; // RFC 9110, 15.4.3
-        case http::StatusSeeOther          : return "See Other"; // RFC 9110, 15.4.4
-        case http::StatusNotModified       : return "Not Modified"; // RFC 9110, 15.4.5
-        case http::StatusUseProxy          : return "Use Proxy"; // RFC 9110, 15.4.6
-        case http::StatusTemporaryRedirect : return "Temporary Redirect"; // RFC 9110, 15.4.8
-        case http::StatusPermanentRedirect : return "Permanent Redirect"; // RFC 9110, 15.4.9
-
-        // 400
-        case http::StatusBadRequest                   : return "Bad Request"; // RFC 9110, 15.5.1
-        case http::StatusUnauthorized                 : return "Unauthorized"; // RFC 9110, 15.5.2
-        case http::StatusPaymentRequired              : return "Payment Required"; // RFC 9110, 15.5.3
-        case http::StatusForbidden                    : return "Forbidden"; // RFC 9110, 15.5.4
-        case http::StatusNotFound                     : return "Not Found"; // RFC 9110, 15.5.5
-        case http::StatusMethodNotAllowed             : return "Method Not Allowed"; // RFC 9110, 15.5.6
-        case http::StatusNotAcceptable                : return "Not Acceptable"; // RFC 9110, 15.5.7
-        case http::StatusProxyAuthRequired            : return "Proxy AuthRequired"; // RFC 9110, 15.5.8
-        case http::StatusRequestTimeout               : return "Request Timeout"; // RFC 9110, 15.5.9
-        case http::StatusConflict                     : return "Conflict"; // RFC 9110, 15.5.10
-        case http::StatusGone                         : return "Gone"; // RFC 9110, 15.5.11
-        case http::StatusLengthRequired               : return "Length Required"; // RFC 9110, 15.5.12
-        case http::StatusPreconditionFailed           : return "Precondition Failed"; // RFC 9110, 15.5.13
-        case http::StatusRequestEntityTooLarge        : return "Request Entity TooLarge"; // RFC 9110, 15.5.14
-        case http::StatusRequestURITooLong            : return "Request URI TooLong"; // RFC 9110, 15.5.15
-        case http::StatusUnsupportedMediaType         : return "Unsupported Media Type"; // RFC 9110, 15.5.16
-        case http::StatusRequestedRangeNotSatisfiable : return "Requested Range Not Satisfiable"; // RFC 9110, 15.5.17
-        case http::StatusExpectationFailed            : return "Expectation Failed"; // RFC 9110, 15.5.18
-        case http::StatusTeapot                       : return "Teapot"; // RFC 9110, 15.5.19 (Unused)
-        case http::StatusMisdirectedRequest           : return "Misdirected Request"; // RFC 9110, 15.5.20
-        case http::StatusUnprocessableEntity          : return "Unprocessable Entity"; // RFC 9110, 15.5.21
-        case http::StatusLocked                       : return "Locked"; // RFC 4918, 11.3
-        case http::StatusFailedDependency             : return "Failed Dependency"; // RFC 4918, 11.4
-        case http::StatusTooEarly                     : return "Too Early"; // RFC 8470, 5.2.
-        case http::StatusUpgradeRequired              : return "Upgrade Required"; // RFC 9110, 15.5.22
-        case http::StatusPreconditionRequired         : return "Precondition Required"; // RFC 6585, 3
-        case http::StatusTooManyRequests              : return "Too Many Requests"; // RFC 6585, 4
-        case http::StatusRequestHeaderFieldsTooLarge  : return "Request Header Fields TooLarge"; // RFC 6585, 5
-        case http::StatusUnavailableForLegalReasons   : return "Unavailable For Legal Reasons"; // RFC 7725, 3
-
-        // 500
-        case http::StatusInternalServerError           : return "Internal Server Error"; // RFC 9110, 15.6.1
-        case http::StatusNotImplemented                : return "Not Implemented"; // RFC 9110, 15.6.2
-        case http::StatusBadGateway                    : return "Bad Gateway"; // RFC 9110, 15.6.3
-        case http::StatusServiceUnavailable            : return "Service Unavailable"; // RFC 9110, 15.6.4
-        case http::StatusGatewayTimeout                : return "Gateway Timeout"; // RFC 9110, 15.6.5
-        case http::StatusHTTPVersionNotSupported       : return "HTTP Version Not Supported"; // RFC 9110, 15.6.6
-        case http::StatusVariantAlsoNegotiates         : return "Variant Also Negotiates"; // RFC 2295, 8.1
-        case http::StatusInsufficientStorage           : return "Insufficient Storage"; // RFC 4918, 11.5
-        case http::StatusLoopDetected                  : return "Loop Detected"; // RFC 5842, 7.2
-        case http::StatusNotExtended                   : return "Not Extended"; // RFC 2774, 7
-        case http::StatusNetworkAuthenticationRequired : return "Network Authentication Required"; // RFC 6585, 6
-        default: return "Unknown";
-    }
-}
\ No newline at end of file
+bool http::Server::keep_connection(int socket_number) {
+    return not sessions[socket_number].close;
+}
@@ -2,7 +2,9 @@
 #define WIZCHIP_HTTP_SERVER_H
 
 #include "wizchip/tcp/server.h"
-#include "wizchip/http/request.h"
+#include "wizchip/http/request_view.h"
+#include "wizchip/http/parser.h"
+#include "wizchip/http/arena.h"
 #include "wizchip/http/response.h"
 #include "etl/json_serialize.h"
 #include "etl/json_deserialize.h"
@@ -10,8 +12,8 @@
 namespace Project::wizchip::http {
     class Server : public tcp::Server {
     public:
-        using RouterFunction = std::function<void(const Request&, Response&)>;
-        using HeaderGenerator = etl::UnorderedMap<std::string, std::function<std::string(const Request&, const Response&)>>;
+        using RouterFunction = std::function<void(const RequestView&, Response&)>;
+        using HeaderGenerator = etl::UnorderedMap<std::string, std::function<std::string(const RequestView&, const Response&)>>;
 
         struct Error {
             int status;
@@ -21,12 +23,46 @@ namespace Project::wizchip::http {
         template <typename T>
         using Result = etl::Result<T, Error>;
 
+        /// request method bits
+        enum Method : uint16_t {
+            MethodGet     = 1 << 0,
+            MethodHead    = 1 << 1,
+            MethodPost    = 1 << 2,
+            MethodPut     = 1 << 3,
+            MethodDelete  = 1 << 4,
+            MethodConnect = 1 << 5,
+            MethodOptions = 1 << 6,
+            MethodTrace   = 1 << 7,
+            MethodPatch   = 1 << 8,
+        };
+
+        /// method bit of a method name, 0 when unknown
+        static uint16_t method_mask(std::string_view method);
+
+        /// value of the Allow header of a 405 response, e.g. `GET, HEAD`
+        static std::string allow_header(uint16_t methods);
+
         struct Router {
-            std::string path;
-            etl::Vector<const char*> methods;
+            std::string path;                   ///< segments in braces, e.g. `/devices/{id}`, capture path parameters.
+            uint16_t methods;                   ///< accepted methods, bitmask of Method.
             RouterFunction function;
+            etl::Vector<std::string> params;    ///< names of the path parameters, in order.
+            Router* next = nullptr;             ///< next route registered on the same path.
         };
 
+        /// tag of the path parameter arg source
+        struct PathParam {};
+
+        /// request parts given to handlers by the arg:: constants, resolved at compile time
+        enum class Source { Request, Response, Url, Headers, Queries, Path, FullPath, Fragment, Version, Method, Body, Json, Text };
+
+        template <Source S> 
+        struct SourceTag {};
+
+        template <typename T> struct is_source : etl::false_type {};
+        template <Source S> struct is_source<SourceTag<S>> : etl::true_type {};
+        template <typename T> static constexpr bool is_source_v = is_source<T>::value;
+
         template <typename T>
         struct RouterArg {
             const char* name;
@@ -78,7 +114,7 @@ namespace Project::wizchip::http {
 
         template <typename... Args, typename F> 
         auto Trace(std::string path, std::tuple<RouterArg<Args>...> args, F&& handler) {
-            return route(etl::move(path), {"Trace"}, etl::move(args), etl::forward<F>(handler));
+            return route(etl::move(path), {"TRACE"}, etl::move(args), etl::forward<F>(handler));
         }
 
         template <typename... Args, typename F> 
@@ -91,15 +127,112 @@ namespace Project::wizchip::http {
             return route(etl::move(path), {"OPTIONS"}, etl::move(args), etl::forward<F>(handler));
         }
 
+        /// HTTP/1.1 persistent connection settings
+        struct KeepAlive {
+            bool enabled = true;            ///< when false every connection is closed after its response.
+            uint32_t timeout_ms = 5000;     ///< idle connections are closed after this long.
+            int max_requests = 100;         ///< requests served per connection before it is closed, 0 for unlimited.
+        };
+
+        KeepAlive keep_alive;
+        size_t chunk_size = 512;            ///< chunk buffer of streamed responses, see Response::generator.
+        Parser::Limits limits;              ///< request head limits, applied to connections opened after a change.
+        size_t arena_size = 2048;           ///< arena of each connection for the request bytes and the response head, allocated on its first request and kept, 0 disables it.
+        uint32_t body_timeout_ms = 5000;    ///< the rest of a body that did not come with its head has this long to arrive, or 408 is answered.
+
+        /// request arena and heap usage, for sizing arena_size and checking the heap under load
+        struct MemoryStats {
+            size_t arena_size;
+            size_t arena_high_water;        ///< most arena bytes taken by one request, on any connection.
+            uint32_t arena_overflows;       ///< requests and response heads that did not fit and went to the heap.
+            size_t heap_free;
+            size_t heap_low_water;          ///< least free heap seen when a request was served.
+        };
+
+        MemoryStats memory_stats() const;
+
+        /// file in read-only memory, the ETag and the gzip variant are produced at build time
+        struct Asset {
+            const uint8_t* data;
+            size_t size;
+            const char* content_type;
+            const char* etag = nullptr;         ///< quoted entity tag, e.g. "\"3f2a9c\"", no revalidation when null.
+            const uint8_t* gzip_data = nullptr; ///< gzip compressed variant, sent when the client accepts it.
+            size_t gzip_size = 0;
+        };
+
+        /// finds the asset of a path relative to the mount prefix, null when there is none
+        using AssetProvider = std::function<const Asset*(std::string_view path)>;
+
+        /// serve assets under a path prefix for GET and HEAD, after the routes. A path ending with '/' maps to index.html
+        void serve_static(std::string prefix, AssetProvider provider);
+
+        /// asset table entry, path is relative to the mount prefix
+        struct AssetFile {
+            const char* path;
+            Asset asset;
+        };
+
+        template <size_t N>
+        void serve_static(std::string prefix, const AssetFile (&files)[N]) {
+            serve_static(etl::move(prefix), [&files](std::string_view path) -> const Asset* {
+                for (auto& file : files) if (path == file.path) return &file.asset;
+                return nullptr;
+            });
+        }
+
         HeaderGenerator global_headers;
-        std::function<void(const Request&, const Response&)> logger = {};
-        std::function<void(Error, const Request&, Response&)> error_handler = default_error_handler;
+        std::function<void(const RequestView&, const Response&)> logger = {};
+        std::function<void(Error, const RequestView&, Response&)> error_handler = default_error_handler;
         etl::LinkedList<Router> routers;
+        static constexpr size_t max_path_params = RequestView::max_params;
         const char* name = "stm32-wizchip/" WIZCHIP_VERSION;
         bool show_response_time = false;
 
     protected:
         Stream response(int socket_number, etl::Vector<uint8_t> data) override;
+        int on_closed(int socket_number) override;
+        bool keep_connection(int socket_number) override;
+        uint32_t idle_timeout(int) override { return keep_alive.enabled ? keep_alive.timeout_ms : 0; }
+        Stream overload_response(int socket_number) override;
+
+        /// state of the connection on each socket
+        struct Session {
+            int requests;                   ///< requests served on this connection.
+            bool close;                     ///< the connection is closed after the current response.
+            etl::Vector<uint8_t> pending;   ///< received bytes of an incomplete request.
+            Parser parser;                  ///< state of the request head being received.
+            size_t parsed;                  ///< bytes of pending already fed to the parser.
+            Arena arena;                    ///< request bytes and response head of the current request.
+        };
+        Session sessions[_WIZCHIP_SOCK_NUM_] = {};
+        std::atomic<size_t> heap_low_water = SIZE_MAX;
+
+        /// the view is taken by reference, it is the largest object on the worker stack
+        Stream process(int socket_number, RequestView&& request, bool no_memory);
+
+        /// node of the route tree, one per path segment
+        struct RouteNode {
+            std::string segment;                ///< literal segment, empty for a path parameter.
+            bool is_param;
+            RouteNode* child;                   ///< first child, literals are placed before the parameter.
+            RouteNode* sibling;
+            Router* router;                     ///< routes ending at this node, chained by Router::next.
+        };
+        etl::LinkedList<RouteNode> route_nodes;
+        RouteNode* route_root = nullptr;
+
+        struct StaticMount {
+            std::string prefix;
+            AssetProvider provider;
+        };
+        etl::LinkedList<StaticMount> static_mounts;
+
+        bool serve_asset(const RequestView& request, Response& response);
+
+        void add_route(Router& router);
+        Router* find_route(std::string_view path, std::string_view (&values)[max_path_params]);
+        Router* match_route(RouteNode* node, std::string_view path, std::string_view (&values)[max_path_params], size_t depth);
 
         template <typename... RouterArgs, typename R, typename ...HandlerArgs>
         auto route_(
@@ -110,7 +243,7 @@ namespace Project::wizchip::http {
         ) {
             static_assert(sizeof...(RouterArgs) == sizeof...(HandlerArgs));
 
-            RouterFunction function = [this, args=etl::move(args), handler] (const Request& req, Response& res) {
+            RouterFunction function = [this, args=etl::move(args), handler] (const RequestView& req, Response& res) {
                 // process each args
                 std::tuple<Result<HandlerArgs>...> arg_values = std::apply([&](const auto&... items) {
                     return std::tuple { process_arg<HandlerArgs>(items, req, res)... };
@@ -147,11 +280,15 @@ namespace Project::wizchip::http {
                 } 
             };
 
-            routers.push(Router{etl::move(path), etl::move(methods), etl::move(function)});
+            uint16_t mask = 0;
+            for (auto method : methods) mask |= method_mask(method);
+
+            routers.push(Router{etl::move(path), mask, etl::move(function)});
+            add_route(routers.back());
             return handler;
         }
 
-        static void default_error_handler(Error err, const Request&, Response& res) {
+        static void default_error_handler(Error err, const RequestView&, Response& res) {
             res.status = err.status;
             res.body = etl::move(err.what);
         }
@@ -161,21 +298,45 @@ namespace Project::wizchip::http {
         }
         
         template <typename T, typename Arg> static Result<T>
-        process_arg(const RouterArg<Arg>& arg, const Request& req, Response& res) {
-            static_assert(etl::is_same_v<Arg, void> || etl::is_same_v<typename RouterArg<Arg>::value_type, T>);
-            const std::string key = arg.name;
-            if (key[0] == '$') {
-                return get_parameter<T>(key, req, res);
-            } else if (req.headers.has(key)) {
-                return convert_string_into<T>(req.headers[key]);
-            } else if (req.path.queries.has(key)) {
-                return convert_string_into<T>(req.path.queries[key]);
+        process_arg(const RouterArg<Arg>& arg, const RequestView& req, Response& res) {
+            static_assert(etl::is_same_v<Arg, void> || etl::is_same_v<Arg, PathParam> || is_source_v<Arg> || etl::is_same_v<typename RouterArg<Arg>::value_type, T>);
+            if constexpr (is_source_v<Arg>) {
+                return get_parameter<T>(Arg{}, req, res);
+            } else if constexpr (etl::is_same_v<Arg, PathParam>) {
+                if (req.has_param(arg.name)) {
+                    return convert_field_into<T>(req.param(arg.name), [&]() -> auto& { return req.request().params[std::string(arg.name)]; });
+                } else {
+                    return etl::Err(internal_error("path parameter is not in the route"));
+                }
+            } else {
+                return get_named<T>(arg, req, res);
+            }
+        }
+
+        /// arg looked up by name in the headers, the queries and the JSON body, in that order
+        template <typename T, typename Arg> static Result<T>
+        get_named(const RouterArg<Arg>& arg, const RequestView& req, Response& res) {
+            const std::string_view key = arg.name;
+            if (req.has_header(key)) {
+                return convert_string_into<T>(req.header(key));
+            } else if (req.has_query(key)) {
+                auto value = req.query_value(key);
+                if (value.find('%') != std::string_view::npos) {
+                    // percent encoded values are decoded by the owning request
+                    return convert_string_into<T>(req.request().path.queries[std::string(key)]);
+                }
+                return convert_field_into<T>(value, [&]() -> auto& { return req.request().path.queries[std::string(key)]; });
             } else {
                 if (arg.name && arg.name[0] != '\0' && get_content_type(req) == "application/json") {
-                    auto arg_val = etl::Json::parse(etl::StringView{req.body.data(), req.body.size()})[arg.name];
+                    auto arg_val = req.json()[arg.name];
                     if (arg_val) {
-                        auto sv = arg_val.dump();
-                        return convert_string_into<T>({sv.data(), sv.len()});
+                        if constexpr (etl::is_same_v<T, const char*>) {
+                            // the dumped value does not outlive this call
+                            return etl::Err(internal_error("arg of a JSON body value cannot be const char*"));
+                        } else {
+                            auto sv = arg_val.dump();
+                            return convert_string_into<T>({sv.data(), sv.len()});
+                        }
                     }
                 }
                 if constexpr (RouterArg<Arg>::has_default) {
@@ -203,7 +364,7 @@ namespace Project::wizchip::http {
         }
 
         template <typename T> static void
-        process_result(T& result, const Request&, Response& res) {
+        process_result(T& result, const RequestView&, Response& res) {
             if constexpr (etl::is_same_v<T, std::string> || etl::is_same_v<T, std::string_view> || etl::is_same_v<T, const char*>) {
                 res.body = etl::move(result);
                 res.headers["Content-Type"] = "text/plain";
@@ -212,95 +373,102 @@ namespace Project::wizchip::http {
                 res.headers["Content-Type"] = "text/plain";
             } else if constexpr (etl::is_same_v<T, Response>) {
                 res = etl::move(result);
+            } else if constexpr (etl::is_same_v<T, Response::Generator>) {
+                res.generator = etl::move(result);
             } else {
                 res.body = etl::json::serialize(result);
                 res.headers["Content-Type"] = "application/json";
             }
         }
 
+        /// media type of the body, without parameters such as charset
         static std::string_view
-        get_content_type(const Request& req) {
-            if (req.headers.has("Content-Type")) {
-                return req.headers["Content-Type"];
-            } else if (req.headers.has("content-type")) {
-                return req.headers["content-type"];
-            } else {
-                return "";
-            }
+        get_content_type(const RequestView& req) {
+            auto content_type = req.header("Content-Type");
+            content_type = content_type.substr(0, content_type.find(';'));
+            while (not content_type.empty() && content_type.back() == ' ') content_type.remove_suffix(1);
+            return content_type;
         }
         
-        template <typename T> static Result<T>
-        get_parameter(const std::string& key, const Request& req, Response& res) {
-            if (key == "$request") {
-                if constexpr (etl::is_same_v<T, etl::Ref<const Request>>) {
+        template <typename T, Source S> static Result<T>
+        get_parameter(SourceTag<S>, const RequestView& req, Response& res) {
+            if constexpr (S == Source::Request) {
+                if constexpr (etl::is_same_v<T, etl::Ref<const RequestView>>) {
                     return etl::Ok(etl::ref_const(req));
+                } else if constexpr (etl::is_same_v<T, etl::Ref<const Request>>) {
+                    return etl::Ok(etl::ref_const(req.request()));
                 } else {
-                    return etl::Err(internal_error("arg type $request must be etl::Ref<const Request>"));
+                    return etl::Err(internal_error("arg type $request must be etl::Ref<const RequestView> or etl::Ref<const Request>"));
                 }
-            } else if (key == "$response") {
+            } else if constexpr (S == Source::Response) {
                 if constexpr (etl::is_same_v<T, etl::Ref<Response>>) {
                     return etl::Ok(etl::ref(res));
                 } else {
-                    return etl::Err(internal_error("arg type $request must be etl::Ref<Response>"));
+                    return etl::Err(internal_error("arg type $response must be etl::Ref<Response>"));
                 }
-            }
-            else if (key == "$url") {
+            } else if constexpr (S == Source::Url) {
                 return get_url<T>(req);
-            } else if (key == "$headers") {
+            } else if constexpr (S == Source::Headers) {
                 return get_headers<T>(req);
-            } else if (key == "$queries") {
+            } else if constexpr (S == Source::Queries) {
                 return get_queries<T>(req);
-            } else if (key == "$path") {
-                return convert_string_into<T>(req.path.path);
-            } else if (key == "$full_path") {
-                return convert_string_into<T>(req.path.full_path);
-            } else if (key == "$fragment") {
-                return convert_string_into<T>(req.path.fragment);
-            } else if (key == "$version") {
+            } else if constexpr (S == Source::Path) {
+                return convert_field_into<T>(req.path, [&]() -> auto& { return req.request().path.path; });
+            } else if constexpr (S == Source::FullPath) {
+                return convert_string_into<T>(req.full_path);
+            } else if constexpr (S == Source::Fragment) {
+                return convert_string_into<T>(req.fragment);
+            } else if constexpr (S == Source::Version) {
                 return convert_string_into<T>(req.version);
-            } else if (key == "$method") {
+            } else if constexpr (S == Source::Method) {
                 return convert_string_into<T>(req.method);
-            } else if (key == "$body") {
-                return convert_string_into<T>(req.body);
+            } else if constexpr (S == Source::Body) {
+                return convert_field_into<T>(req.body, [&]() -> auto& { return req.request().body; });
+            } else if constexpr (S == Source::Json) {
+                if (get_content_type(req) != "application/json") {
+                    return etl::Err(Error{StatusUnsupportedMediaType, "body is not application/json"});
+                } else if constexpr (etl::is_same_v<T, etl::Ref<const etl::Json>>) {
+                    return etl::Ok(etl::ref_const(req.json()));
+                } else {
+                    return convert_field_into<T>(req.body, [&]() -> auto& { return req.request().body; });
+                }
             } else {
-                auto content_type = get_content_type(req);
-                if (key == "$json" && content_type == "application/json") {
-                    return convert_string_into<T>(req.body);
-                } else if (key == "$text" && content_type == "text/plain") {
-                    return convert_string_into<T>(req.body);
+                if (get_content_type(req) != "text/plain") {
+                    return etl::Err(Error{StatusUnsupportedMediaType, "body is not text/plain"});
                 } else {
-                    return etl::Err(internal_error("unknown arg"));
+                    return convert_field_into<T>(req.body, [&]() -> auto& { return req.request().body; });
                 }
-            } 
+            }
         }
 
         template <typename T> static Result<T>
-        get_url(const Request& req) {
+        get_url(const RequestView& req) {
             if constexpr (etl::is_same_v<T, etl::Ref<const URL>>) {
-                return etl::Ok(etl::ref_const(req.path));
+                return etl::Ok(etl::ref_const(req.request().path));
             } else {
                 return etl::Err(internal_error("arg type $url must be etl::Ref<const URL>"));
             }
         }
 
         template <typename T> static Result<T>
-        get_headers(const Request& req) {
+        get_headers(const RequestView& req) {
             if constexpr (etl::is_same_v<T, etl::Ref<const decltype(Request::headers)>>) {
-                return etl::Ok(etl::ref_const(req.headers));
+                return etl::Ok(etl::ref_const(req.request().headers));
             } else {
                 return etl::Err(internal_error("arg type $headers must be etl::Ref<const decltype(Request::headers)>"));
             }
         }
 
         template <typename T> static Result<T>
-        get_queries(const Request& req) {
+        get_queries(const RequestView& req) {
             if constexpr (etl::is_same_v<T, etl::Ref<const decltype(URL::queries)>>) {
-                return etl::Ok(etl::ref_const(req.path.queries));
+                return etl::Ok(etl::ref_const(req.request().path.queries));
             } else {
                 return etl::Err(internal_error("arg type $queries must be etl::Ref<const decltype(URL::queries)>"));
             }
         }
 
+        /// `const char*` is only given for a null terminated str
         template <typename T> static Result<T> 
         convert_string_into(std::string_view str) {
             if constexpr (etl::is_same_v<T, std::string> || etl::is_same_v<T, std::string_view> || etl::is_same_v<T, etl::StringView>) {
@@ -313,6 +481,17 @@ namespace Project::wizchip::http {
                 return etl::json::deserialize<T>(str).except(internal_error);
             }
         }
+
+        /// for a field that is not null terminated in the receive buffer, 
+        /// `const char*` points into the owning string of the request given by owned instead
+        template <typename T, typename F> static Result<T> 
+        convert_field_into(std::string_view str, F&& owned) {
+            if constexpr (etl::is_same_v<T, const char*>) {
+                return etl::Ok(owned().c_str());
+            } else {
+                return convert_string_into<T>(str);
+            }
+        }
     };
 
     template <>
@@ -326,6 +505,26 @@ namespace Project::wizchip::http {
         using value_type = void;
     };
 
+    template <Server::Source S>
+    struct Server::RouterArg<Server::SourceTag<S>> {
+        const char* name;
+        static constexpr bool has_default = false;
+        static constexpr bool is_function = false;
+        static constexpr bool has_request_param = false;
+        static constexpr bool is_return_type_result = false;
+        using value_type = void;
+    };
+
+    template <>
+    struct Server::RouterArg<Server::PathParam> {
+        const char* name;
+        static constexpr bool has_default = false;
+        static constexpr bool is_function = false;
+        static constexpr bool has_request_param = false;
+        static constexpr bool is_return_type_result = false;
+        using value_type = void;
+    };
+
     template <typename T>
     struct Server::RouterArg<std::function<T()>> {
         const char* name;
@@ -369,6 +568,28 @@ namespace Project::wizchip::http {
         static constexpr bool is_return_type_result = true;
         using value_type = T;
     };
+
+    template <typename T>
+    struct Server::RouterArg<std::function<T(const RequestView&, Response&)>> {
+        const char* name;
+        std::function<T(const RequestView&, Response&)> get_default;
+        static constexpr bool has_default = true;
+        static constexpr bool is_function = true;
+        static constexpr bool has_request_param = true;
+        static constexpr bool is_return_type_result = false;
+        using value_type = T;
+    };
+
+    template <typename T>
+    struct Server::RouterArg<std::function<Server::Result<T>(const RequestView&, Response&)>> {
+        const char* name;
+        std::function<Result<T>(const RequestView&, Response&)> get_default;
+        static constexpr bool has_default = true;
+        static constexpr bool is_function = true;
+        static constexpr bool has_request_param = true;
+        static constexpr bool is_return_type_result = true;
+        using value_type = T;
+    };
 }
 
 namespace Project::wizchip::http::arg {
@@ -376,6 +597,11 @@ namespace Project::wizchip::http::arg {
         return Server::RouterArg<void> {name};
     }
 
+    /// path parameter captured by the route, e.g. `param("id")` for `/devices/{id}`
+    inline auto param(const char* name) {
+        return Server::RouterArg<Server::PathParam> {name};
+    }
+
     template <typename F>
     auto depends(F&& depends_function) {
         std::function f = etl::forward<F>(depends_function);
@@ -393,19 +619,19 @@ namespace Project::wizchip::http::arg {
         return Server::RouterArg<decltype(f)> { name, etl::move(f) };
     }
 
-    inline static constexpr Server::RouterArg<void> request { "$request" };
-    inline static constexpr Server::RouterArg<void> response { "$response" };
-    inline static constexpr Server::RouterArg<void> url { "$url" };
-    inline static constexpr Server::RouterArg<void> headers { "$headers" };
-    inline static constexpr Server::RouterArg<void> queries { "$queries" };
-    inline static constexpr Server::RouterArg<void> path { "$path" };
-    inline static constexpr Server::RouterArg<void> full_path { "$full_path" };
-    inline static constexpr Server::RouterArg<void> fragment { "$fragment" };
-    inline static constexpr Server::RouterArg<void> version { "$version" };
-    inline static constexpr Server::RouterArg<void> method { "$method" };
-    inline static constexpr Server::RouterArg<void> body { "$body" };
-    inline static constexpr Server::RouterArg<void> json { "$json" };
-    inline static constexpr Server::RouterArg<void> text { "$text" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Request>> request { "$request" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Response>> response { "$response" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Url>> url { "$url" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Headers>> headers { "$headers" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Queries>> queries { "$queries" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Path>> path { "$path" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::FullPath>> full_path { "$full_path" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Fragment>> fragment { "$fragment" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Version>> version { "$version" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Method>> method { "$method" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Body>> body { "$body" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Json>> json { "$json" };
+    inline static constexpr Server::RouterArg<Server::SourceTag<Server::Source::Text>> text { "$text" };
 }
 
 #endif
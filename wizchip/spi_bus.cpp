@@ -0,0 +1,115 @@
+#include "wizchip/spi_bus.h"
+#include <cstring>
+
+using namespace Project::wizchip;
+
+#if defined(USE_HAL_SPI_REGISTER_CALLBACKS) && (USE_HAL_SPI_REGISTER_CALLBACKS == 1U)
+static SpiBus* dma_bus = nullptr;
+#endif
+
+void SpiBus::init() {
+    cs.init({.mode=GPIO_MODE_OUTPUT_OD});
+    cs.write(true);
+
+    if (not dma)
+        return;
+
+    semaphore = osSemaphoreNew(1, 0, nullptr);
+
+#if defined(USE_HAL_SPI_REGISTER_CALLBACKS) && (USE_HAL_SPI_REGISTER_CALLBACKS == 1U)
+    dma_bus = this;
+    auto callback = [](SPI_HandleTypeDef* hspi) { dma_bus->complete_handler(hspi); };
+    HAL_SPI_RegisterCallback(&hspi, HAL_SPI_TX_COMPLETE_CB_ID, callback);
+    HAL_SPI_RegisterCallback(&hspi, HAL_SPI_RX_COMPLETE_CB_ID, callback);
+    HAL_SPI_RegisterCallback(&hspi, HAL_SPI_TX_RX_COMPLETE_CB_ID, callback);
+#endif
+}
+
+void SpiBus::select() {
+    cs.write(false);
+    frame_len = 0;
+    stats.frames++;
+}
+
+void SpiBus::deselect() {
+    flush();
+    cs.write(true);
+}
+
+void SpiBus::write(const uint8_t* buf, uint16_t len) {
+    if (frame_len + len <= sizeof(frame)) {
+        ::memcpy(frame + frame_len, buf, len);
+        frame_len += len;
+        return;
+    }
+
+    flush();
+    transmit(buf, len);
+}
+
+void SpiBus::read(uint8_t* buf, uint16_t len) {
+    if (frame_len == 0 || frame_len + len > sizeof(frame)) {
+        flush();
+        receive(buf, len);
+        return;
+    }
+
+    // address and control phase and the data phase in a single transfer
+    uint8_t rx[sizeof(frame)];
+    ::memset(frame + frame_len, 0, len);
+    transmit_receive(frame, rx, frame_len + len);
+    ::memcpy(buf, rx + frame_len, len);
+    frame_len = 0;
+}
+
+void SpiBus::complete_handler(SPI_HandleTypeDef* hspi_) {
+    if (hspi_ == &hspi && semaphore) osSemaphoreRelease(semaphore);
+}
+
+void SpiBus::flush() {
+    if (frame_len == 0)
+        return;
+
+    transmit(frame, frame_len);
+    frame_len = 0;
+}
+
+void SpiBus::transmit(const uint8_t* buf, uint16_t len) {
+    stats.transfers++;
+    stats.bytes += len;
+    
+    auto data = const_cast<uint8_t*>(buf);
+    if (dma && len >= dma_threshold && HAL_SPI_Transmit_DMA(&hspi, data, len) == HAL_OK) {
+        wait();
+    } else {
+        HAL_SPI_Transmit(&hspi, data, len, HAL_MAX_DELAY);
+    }
+}
+
+void SpiBus::receive(uint8_t* buf, uint16_t len) {
+    stats.transfers++;
+    stats.bytes += len;
+
+    if (dma && len >= dma_threshold && HAL_SPI_Receive_DMA(&hspi, buf, len) == HAL_OK) {
+        wait();
+    } else {
+        HAL_SPI_Receive(&hspi, buf, len, HAL_MAX_DELAY);
+    }
+}
+
+void SpiBus::transmit_receive(const uint8_t* tx, uint8_t* rx, uint16_t len) {
+    stats.transfers++;
+    stats.bytes += len;
+
+    auto data = const_cast<uint8_t*>(tx);
+    if (dma && len >= dma_threshold && HAL_SPI_TransmitReceive_DMA(&hspi, data, rx, len) == HAL_OK) {
+        wait();
+    } else {
+        HAL_SPI_TransmitReceive(&hspi, data, rx, len, HAL_MAX_DELAY);
+    }
+}
+
+void SpiBus::wait() {
+    // the calling thread sleeps until the transfer complete interrupt
+    osSemaphoreAcquire(semaphore, osWaitForever);
+}
@@ -0,0 +1,58 @@
+#ifndef WIZCHIP_SPI_BUS_H
+#define WIZCHIP_SPI_BUS_H
+
+#include "wizchip/bus.h"
+#include "spi.h"
+#include "periph/gpio.h"
+#include "cmsis_os2.h"
+
+namespace Project::wizchip {
+    /// HAL SPI bus. The address and control phase is held back and sent together with the data phase,
+    /// so a register access costs one transfer. Long transfers optionally go through DMA while the calling thread sleeps
+    class SpiBus : public Bus {
+    public:
+        struct Args {
+            SPI_HandleTypeDef& hspi;                ///< SPI handler
+            periph::GPIO cs;                        ///< Chip select pin.
+            bool dma = false;                       ///< use DMA for transfers longer than dma_threshold.
+            uint16_t dma_threshold = 32;            ///< shorter transfers are polled, DMA setup costs more than it saves.
+        };
+
+        explicit SpiBus(Args args) : hspi(args.hspi), cs(args.cs), dma(args.dma), dma_threshold(args.dma_threshold) {}
+
+        /// disable copy constructor and assignment
+        SpiBus(const SpiBus&) = delete;
+        SpiBus& operator=(const SpiBus&) = delete;
+
+        void init();
+
+        void select() override;
+        void deselect() override;
+        void read(uint8_t* buf, uint16_t len) override;
+        void write(const uint8_t* buf, uint16_t len) override;
+
+        /// DMA transfer complete handler, has to be called from HAL_SPI_TxCpltCallback, HAL_SPI_RxCpltCallback
+        /// and HAL_SPI_TxRxCpltCallback unless USE_HAL_SPI_REGISTER_CALLBACKS is enabled
+        void complete_handler(SPI_HandleTypeDef* hspi);
+
+        SPI_HandleTypeDef& hspi;
+        periph::GPIO cs;
+
+    private:
+        void flush();
+        void transmit(const uint8_t* buf, uint16_t len);
+        void receive(uint8_t* buf, uint16_t len);
+        void transmit_receive(const uint8_t* tx, uint8_t* rx, uint16_t len);
+        void wait();
+
+        bool dma;
+        uint16_t dma_threshold;
+        osSemaphoreId_t semaphore = nullptr;
+
+        // address and control phase, plus the data of a single register write
+        uint8_t frame[8];
+        uint16_t frame_len = 0;
+    };
+}
+
+#endif // WIZCHIP_SPI_BUS_H
@@ -1,23 +1,124 @@
 #include "wizchip/stream.h"
 #include "etl/keywords.h"
+#include <cstring>
 
 using namespace wizchip;
 
+// referenced bytes up to this size are cheaper to copy than to send as their own fragment
+static constexpr size_t small_fragment = 16;
+
+bool Stream::copy_to_arena(const uint8_t* data, size_t len) {
+    if (overflow || arena_len + len > arena_capacity)
+        return false;
+
+    // extend the last fragment if it ends where the arena does
+    auto last = fragment_count > 0 ? &fragments[fragment_count - 1] : nullptr;
+    if (last && last->kind == Kind::Arena && last->offset + last->len == arena_len) {
+        ::memcpy(arena + arena_len, data, len);
+        arena_len += len;
+        last->len += len;
+        return true;
+    }
+
+    if (fragment_count == fragment_capacity)
+        return false;
+
+    ::memcpy(arena + arena_len, data, len);
+    fragments[fragment_count++] = {Kind::Arena, nullptr, arena_len, len};
+    arena_len += len;
+    return true;
+}
+
+Stream& Stream::write(const void* data, size_t len) {
+    auto ptr = static_cast<const uint8_t*>(data);
+    if (copy_to_arena(ptr, len)) 
+        return *this;
+    
+    return *this << std::string(reinterpret_cast<const char*>(ptr), len);
+}
+
+Stream& Stream::operator<<(etl::Iter<const uint8_t*> data) {
+    auto ptr = &(*data);
+    size_t len = data.len();
+
+    if (len <= small_fragment && copy_to_arena(ptr, len))
+        return *this;
+
+    if (not overflow && fragment_count < fragment_capacity) {
+        fragments[fragment_count++] = {Kind::External, ptr, 0, len};
+    } else {
+        rules << Rule{[data]() { return data; }, false};
+        overflow = true;
+    }
+    return *this;
+}
+
+Stream& Stream::operator<<(std::string str) {
+    if (copy_to_arena(reinterpret_cast<const uint8_t*>(str.data()), str.size()))
+        return *this;
+
+    return *this << InRule([str=etl::move(str)]() {
+        auto ptr = reinterpret_cast<const uint8_t*>(str.data());
+        return etl::iter(ptr, ptr + str.size());
+    });
+}
+
 Stream& Stream::operator<<(InRule rule) {
-    rules << etl::move(rule);
+    if (not overflow && fragment_count < fragment_capacity) {
+        fragments[fragment_count++] = {Kind::Rule, nullptr, 0, 0};
+    } else {
+        overflow = true;
+    }
+    rules << Rule{etl::move(rule), false};
     return *this;
 }
 
-Stream& Stream::operator<<(etl::Iter<const uint8_t*> data) {
-    rules << [data]() { return data; };
+Stream& Stream::operator<<(Generator generator) {
+    if (not overflow && fragment_count < fragment_capacity) {
+        fragments[fragment_count++] = {Kind::Rule, nullptr, 0, 0};
+    } else {
+        overflow = true;
+    }
+    rules << Rule{etl::move(generator.next), true};
     return *this;
 }
 
+// the rule may own the bytes, it is popped only after they are consumed
+void Stream::drain_rule(OutRule& rule) {
+    auto& front = rules.front();
+    if (not front.repeat) {
+        rule(front.next());
+    } else {
+        for (auto data = front.next(); data.len() > 0; data = front.next()) {
+            rule(data);
+        }
+    }
+    rules.pop_front();
+}
+
 Stream& Stream::operator>>(OutRule rule) {
+    for (auto i in etl::range(int(fragment_count))) {
+        auto& fragment = fragments[i];
+        switch (fragment.kind) {
+            case Kind::External:
+                rule(etl::iter(fragment.data, fragment.data + fragment.len));
+                break;
+            case Kind::Arena: {
+                const uint8_t* ptr = arena + fragment.offset;
+                rule(etl::iter(ptr, ptr + fragment.len));
+                break;
+            }
+            case Kind::Rule:
+                drain_rule(rule);
+                break;
+        }
+    }
+    fragment_count = 0;
+    arena_len = 0;
+    overflow = false;
+
     while (rules.len() > 0) {
-        auto data = rules.front()();
-        rules.pop_front();
-        rule(data);
+        drain_rule(rule);
     }
     return *this;
-}
\ No newline at end of file
+}
@@ -3,20 +3,67 @@
 
 #include "etl/linked_list.h"
 #include <functional>
+#include <string>
 
 namespace Project::wizchip {
+    /// Ordered list of byte fragments to be sent. 
+    /// Fragments are kept in a fixed array and small ones are copied into an inline arena, 
+    /// so building a stream does not allocate unless a lazy rule is added or the capacity is exceeded
     class Stream {
     public:
         using InRule = std::function<etl::Iter<const uint8_t*>()>;
         using OutRule = std::function<void(etl::Iter<const uint8_t*>)>;
 
+        /// lazy generator called repeatedly when the stream is drained, until it returns no bytes.
+        /// The returned bytes only have to stay valid until the next call
+        struct Generator {
+            InRule next;
+        };
+
+        static constexpr size_t fragment_capacity = 24;
+        static constexpr size_t arena_capacity = 192;
+
+        /// referenced bytes, they must outlive the stream. Small ones are copied into the arena
         Stream& operator<<(etl::Iter<const uint8_t*> data);
+        /// owned bytes, copied into the arena when they fit
+        Stream& operator<<(std::string str);
+        /// lazy generator, called once when the stream is drained
         Stream& operator<<(InRule rule);
+        Stream& operator<<(Generator generator);
         Stream& operator>>(OutRule rule);
+
+        /// copy bytes into the arena
+        Stream& write(const void* data, size_t len);
+
+        bool empty() const { return fragment_count == 0 && rules.len() == 0; }
     
     private:
-        etl::LinkedList<InRule> rules;
+        enum class Kind : uint8_t { External, Arena, Rule };
+        
+        struct Fragment {
+            Kind kind;
+            const uint8_t* data;        ///< referenced bytes, when kind is External
+            uint16_t offset;            ///< offset in the arena, when kind is Arena
+            size_t len;
+        };
+
+        bool copy_to_arena(const uint8_t* data, size_t len);
+        void drain_rule(OutRule& rule);
+
+        Fragment fragments[fragment_capacity];
+        uint8_t arena[arena_capacity];
+        uint16_t fragment_count = 0;
+        uint16_t arena_len = 0;
+        bool overflow = false;
+
+        struct Rule {
+            InRule next;
+            bool repeat;        ///< called until it returns no bytes.
+        };
+
+        // lazy rules in order, followed by everything that did not fit in the fragments
+        etl::LinkedList<Rule> rules;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
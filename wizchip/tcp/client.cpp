@@ -8,20 +8,11 @@ using namespace Project::wizchip;
 auto tcp::Client::request(Stream s) -> etl::Future<etl::Vector<uint8_t>> {
     return [this, s=mv | s](etl::Time timeout) mutable -> etl::Result<etl::Vector<uint8_t>, osStatus_t> {
         auto start_time = etl::time::now();
-
-        for (; etl::time::elapsed(start_time) < timeout;) {
-            if (::connect(socket_number, host.data(), port) == SOCK_OK) break; 
-            etl::this_thread::sleep(1ms);
-        }
-
-        if (etl::time::elapsed(start_time) >= timeout) {
-            return etl::Err(osErrorTimeout);
+        auto sent = send(s, timeout);
+        if (sent.is_err()) {
+            return etl::Err(sent.unwrap_err());
         }
 
-        s >> [this](etl::Iter<const uint8_t*> data) {
-            ::send(socket_number, const_cast<uint8_t*>(&(*data)), data.len());
-        };
-
         for (; etl::time::elapsed(start_time) < timeout;) {
             auto r = detail::tcp_receive(socket_number);
             if (r.is_ok()) return r;
@@ -32,3 +23,41 @@ auto tcp::Client::request(Stream s) -> etl::Future<etl::Vector<uint8_t>> {
         return etl::Err(osErrorTimeout);
     };
 }
+
+auto tcp::Client::send(Stream& s, etl::Time timeout) -> etl::Result<void, osStatus_t> {
+    auto connected = connect(timeout);
+    if (connected.is_err()) {
+        return connected;
+    }
+
+    if (detail::tcp_send(socket_number, s) < 0) {
+        return etl::Err(osError);
+    }
+
+    return etl::Ok();
+}
+
+auto tcp::Client::connect(etl::Time timeout) -> etl::Result<void, osStatus_t> {
+    if (socket_number < 0) {
+        return etl::Err(osErrorResource);
+    }
+
+    auto start_time = etl::time::now();
+
+    // a connection kept open by the previous request is reused, one closed by the peer is opened again
+    auto status = getSn_SR(socket_number);
+    if (status != SOCK_ESTABLISHED && status != SOCK_INIT) {
+        reopen();
+    }
+
+    for (; status != SOCK_ESTABLISHED && etl::time::elapsed(start_time) < timeout;) {
+        if (::connect(socket_number, host.data(), port) == SOCK_OK) break; 
+        etl::this_thread::sleep(1ms);
+    }
+
+    if (etl::time::elapsed(start_time) >= timeout) {
+        return etl::Err(osErrorTimeout);
+    }
+
+    return etl::Ok();
+}
@@ -15,6 +15,11 @@ namespace Project::wizchip::tcp {
         Client(Args args) : SocketSession(Sn_MR_TCP, 0, args.host, args.port) {}
         etl::Future<etl::Vector<uint8_t>> request(Stream s) override;
         etl::Future<Stream> request_test(Stream s);
+
+    protected:
+        /// connect unless the connection is still established, then send the stream
+        etl::Result<void, osStatus_t> send(Stream& s, etl::Time timeout);
+        etl::Result<void, osStatus_t> connect(etl::Time timeout);
     };
 } 
 
@@ -1,6 +1,5 @@
 #include "wizchip/tcp/server.h"
 #include "Ethernet/socket.h"
-#include "etl/async.h"
 #include "etl/keywords.h"
 
 using namespace Project::wizchip;
@@ -15,6 +14,37 @@ int tcp::Server::on_listen(int) {
 }
 
 int tcp::Server::on_established(int socket_number) {
+    auto& conn = connections[socket_number];
+    if (conn.busy) {
+        return SOCK_OK;
+    }
+
+    if (conn.closing) {
+        if (Ethernet::self->sending(socket_number)) return SOCK_OK;
+        conn.closing = false;
+        return ::disconnect(socket_number);
+    }
+
+    uint32_t now = etl::time::now().tick;
+    if (not conn.open) {
+        conn.open = true;
+        conn.last_active = now;
+    }
+
+    if (::getSn_RX_RSR(socket_number) == 0) {
+        auto timeout = idle_timeout(socket_number);
+        if (timeout > 0 && now - conn.last_active >= timeout) {
+            return ::disconnect(socket_number);
+        }
+        return SOCK_OK;
+    }
+
+    // the request waits in the chip until a worker is free
+    bool overloaded = workers.isRunning() && workers.full();
+    if (overloaded && overload == Overload::Queue) {
+        return SOCK_OK;
+    }
+
     auto res = detail::tcp_receive(socket_number);
     if (res.is_err()) {
         auto err = res.unwrap_err();
@@ -25,29 +55,67 @@ int tcp::Server::on_established(int socket_number) {
         }
     }
 
-    auto future = etl::async([this, socket_number, data=etl::move(res.unwrap())]() mutable {
+    if (overloaded) {
+        return reject(socket_number);
+    }
+
+    // one response at a time per connection, pipelined data is read once the previous response is sent
+    conn.busy = true;
+    conn.last_active = now;
+
+    bool dispatched = workers.dispatch(worker_pool, [this, socket_number, data=etl::move(res.unwrap())]() mutable {
+        // the event loop sends the queued response, other sockets are served while this one drains
         auto res = this->response(socket_number, etl::move(data));
-        auto lock = Ethernet::self->mutex.lock().await();
-        res >> [socket_number](etl::Iter<const uint8_t*> data) {
-            ::send(socket_number, const_cast<uint8_t*>(&(*data)), data.len());
-        };
-        // ::disconnect(socket_number);
+        detail::tcp_send(socket_number, res);
+
+        auto lock = Ethernet::self->socket_mutex[socket_number].lock().await();
+        auto& conn = connections[socket_number];
+        conn.last_active = etl::time::now().tick;
+
+        if (not keep_connection(socket_number)) {
+            ::disconnect(socket_number);
+        }
+        conn.busy = false;
     });
     
     // no thread available
-    if (not future.valid()) {
-        ::disconnect(socket_number);
-        return SOCK_ERROR;
+    if (not dispatched) {
+        conn.busy = false;
+        return overload == Overload::Reject ? reject(socket_number) : ::disconnect(socket_number);
     }
 
     return SOCK_OK;
 }
 
+int tcp::Server::reject(int socket_number) {
+    // called from the event loop, which drains the send queue, so it must not wait for room in it.
+    // The response is queued only when it fits and the connection is closed once it is sent
+    auto s = overload_response(socket_number);
+    if (s.empty() || not Ethernet::self->try_send(socket_number, s)) {
+        return ::disconnect(socket_number);
+    }
+
+    connections[socket_number].closing = true;
+    return SOCK_OK;
+}
+
 int tcp::Server::on_close_wait(int socket_number) {
+    // the peer may half close right after its request, let the response go out first
+    if (connections[socket_number].busy) {
+        return SOCK_OK;
+    }
+
     return ::disconnect(socket_number);
 }
 
 int tcp::Server::on_closed(int socket_number) {
+    // the socket is reopened once the pending response is done with it
+    if (connections[socket_number].busy) {
+        return SOCK_OK;
+    }
+
+    connections[socket_number].open = false;
+    connections[socket_number].closing = false;
     auto res = ::socket(socket_number, Sn_MR_TCP, port, Sn_MR_ND);
     return res == socket_number ? SOCK_OK : res;
 }
@@ -2,9 +2,26 @@
 #define WIZCHIP_TCP_SERVER_H
 
 #include "wizchip/ethernet.h"
+#include "wizchip/worker_pool.h"
 
 namespace Project::wizchip::tcp {
     class Server : public SocketServer {
+    public:
+        /// established connections without any traffic for this long are disconnected, 0 keeps them open
+        uint32_t idle_timeout_ms = 0;
+
+        /// threads generating the responses, started on the first request. With 0 workers each request gets an etl::async thread
+        WorkerPool::Args worker_pool = {};
+
+        /// what happens to a request when every worker is busy and the queue is full
+        enum class Overload {
+            Queue,      ///< the request stays in the chip RX buffer until a worker is free, TCP flow control holds the client.
+            Reject,     ///< the request is read out and answered with overload_response(), then the connection is closed.
+        };
+        Overload overload = Overload::Queue;
+
+        WorkerPool::Stats worker_stats() const { return workers.stats(); }
+
     protected:
         int on_init(int socket_number) override;
         int on_listen(int socket_number) override;
@@ -12,7 +29,28 @@ namespace Project::wizchip::tcp {
         int on_close_wait(int socket_number) override;
         int on_closed(int socket_number) override;
         const char* kind() override { return "TCP"; }
+
+        /// called after each response is sent, the connection is disconnected when false
+        virtual bool keep_connection(int) { return true; }
+
+        /// idle timeout of the connection in ms, 0 keeps it open
+        virtual uint32_t idle_timeout(int) { return idle_timeout_ms; }
+
+        /// sent instead of a response when the request is rejected on overload, nothing is sent when empty
+        virtual Stream overload_response(int) { return {}; }
+
+        struct Connection {
+            std::atomic<bool> busy;     ///< a response is being generated or sent, incoming data stays in the chip.
+            bool open;                  ///< the connection has been seen established.
+            bool closing;               ///< disconnected once the queued overload response is sent.
+            uint32_t last_active;       ///< tick of the last received or sent data.
+        };
+        Connection connections[_WIZCHIP_SOCK_NUM_] = {};
+        WorkerPool workers;
+
+        /// answer with overload_response() when it fits in the send queue without waiting, and close the connection
+        int reject(int socket_number);
     };
 } 
 
-#endif // WIZCHIP_TCP_SERVER_H
\ No newline at end of file
+#endif // WIZCHIP_TCP_SERVER_H
@@ -6,8 +6,12 @@ using namespace wizchip;
 
 auto udp::Client::request(Stream s) -> etl::Future<etl::Vector<uint8_t>> {
     return [this, s=mv | s](etl::Time timeout) mutable -> etl::Result<etl::Vector<uint8_t>, osStatus_t> {
+        if (socket_number < 0) {
+            return etl::Err(osErrorResource);
+        }
+
         s >> [this](etl::Iter<const uint8_t*> data) {
-            ::sendto(socket_number, const_cast<uint8_t*>(&(*data)), data.len(), host.data(), port);
+            detail::udp_send(socket_number, &(*data), data.len(), host.data(), port);
         };
         
         size_t retry = timeout.tick;
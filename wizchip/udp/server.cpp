@@ -1,6 +1,5 @@
 #include "wizchip/udp/server.h"
 #include "Ethernet/socket.h"
-#include "etl/async.h"
 #include "etl/keywords.h"
 
 using namespace Project::wizchip;
@@ -15,6 +14,10 @@ int udp::Server::on_listen(int socket_number) {
 }
 
 int udp::Server::on_established(int socket_number) {
+    if (workers.isRunning() && workers.full()) {
+        return SOCK_OK;
+    }
+
     auto res = detail::udp_receive(socket_number, client_ip);
     if (res.is_err()) {
         auto err = res.unwrap_err();
@@ -25,17 +28,17 @@ int udp::Server::on_established(int socket_number) {
         }
     }
 
-    auto future = etl::async([this, socket_number, data=etl::move(res.unwrap())]() mutable {
+    bool dispatched = workers.dispatch(worker_pool, [this, socket_number, data=etl::move(res.unwrap())]() mutable {
         auto res = this->response(socket_number, etl::move(data));
-        auto lock = Ethernet::self->mutex.lock().await();
+        auto lock = Ethernet::self->socket_mutex[socket_number].lock().await();
         res >> [this, socket_number](etl::Iter<const uint8_t*> data) {
-            ::sendto(socket_number, const_cast<uint8_t*>(&(*data)), data.len(), client_ip.data(), port);
+            detail::udp_send(socket_number, &(*data), data.len(), client_ip.data(), port);
         };
         // ::disconnect(socket_number);
     });
     
     // no thread available
-    if (not future.valid()) {
+    if (not dispatched) {
         ::disconnect(socket_number);
         return SOCK_ERROR;
     }
@@ -2,6 +2,7 @@
 #define WIZCHIP_UDP_SERVER_H
 
 #include "wizchip/ethernet.h"
+#include "wizchip/worker_pool.h"
 #include "etl/vector.h"
 #include "etl/future.h"
 
@@ -10,6 +11,12 @@ namespace Project::wizchip::udp {
     public:
         etl::Vector<uint8_t> client_ip;
 
+        /// threads generating the responses, started on the first datagram. With 0 workers each one gets an etl::async thread.
+        /// Datagrams stay in the chip RX buffer while every worker is busy and the queue is full
+        WorkerPool::Args worker_pool = {};
+
+        WorkerPool::Stats worker_stats() const { return workers.stats(); }
+
     protected:
         int on_init(int socket_number) override;
         int on_listen(int socket_number) override;
@@ -17,6 +24,8 @@ namespace Project::wizchip::udp {
         int on_close_wait(int socket_number) override;
         int on_closed(int socket_number) override;
         const char* kind() override { return "UDP"; }
+
+        WorkerPool workers;
     };
 }
 
@@ -0,0 +1,116 @@
+#include "wizchip/worker_pool.h"
+#include "etl/async.h"
+#include "etl/heap.h"
+#include "etl/time.h"
+#include "etl/keywords.h"
+
+using namespace Project::wizchip;
+
+auto WorkerPool::start(Args args_) -> etl::Result<void, osStatus_t> {
+    if (isRunning()) {
+        return etl::Err(osErrorResource);
+    }
+
+    if (args_.workers <= 0 || etl::heap::freeSize < size_t(args_.workers) * (args_.stack_size + sizeof(osThreadId_t))) {
+        return etl::Err(osErrorNoMemory);
+    }
+
+    args = args_;
+    available = osSemaphoreNew(args.queue_size + args.workers, 0, nullptr);
+    if (available == nullptr) {
+        return etl::Err(osErrorNoMemory);
+    }
+
+    threads.reserve(args.workers);
+    for (int i = 0; i < args.workers; ++i) {
+        osThreadAttr_t attr = {};
+        attr.name = "wizchip_worker";
+        attr.stack_size = args.stack_size;
+        attr.priority = args.priority;
+
+        auto id = osThreadNew(&WorkerPool::worker, this, &attr);
+        if (id == nullptr) break;
+        threads.append(id);
+    }
+
+    if (threads.len() == 0) {
+        return etl::Err(osErrorNoMemory);
+    }
+
+    metrics.workers = threads.len();
+    return etl::Ok();
+}
+
+bool WorkerPool::full() const {
+    auto lock = mutex.lock().await();
+    return metrics.depth + metrics.busy >= metrics.workers + args.queue_size;
+}
+
+bool WorkerPool::submit(std::function<void()> job) {
+    {
+        auto lock = mutex.lock().await();
+
+        // a job waits in the queue only while every worker is busy
+        if (not isRunning() || metrics.depth + metrics.busy >= metrics.workers + args.queue_size) {
+            metrics.rejected++;
+            return false;
+        }
+
+        jobs << Job{etl::move(job), etl::time::now().tick};
+        metrics.depth++;
+        if (metrics.depth > metrics.max_depth) metrics.max_depth = metrics.depth;
+    }
+
+    osSemaphoreRelease(available);
+    return true;
+}
+
+bool WorkerPool::dispatch(const Args& args_, std::function<void()> job) {
+    if (args_.workers > 0 && not isRunning()) {
+        start(args_);
+    }
+
+    if (isRunning()) {
+        return submit(etl::move(job));
+    }
+
+    return etl::async(etl::move(job)).valid();
+}
+
+auto WorkerPool::stats() const -> Stats {
+    auto lock = mutex.lock().await();
+    return metrics;
+}
+
+void WorkerPool::worker(void* arg) {
+    static_cast<WorkerPool*>(arg)->run();
+}
+
+void WorkerPool::run() {
+    while (true) {
+        osSemaphoreAcquire(available, osWaitForever);
+
+        std::function<void()> function;
+        {
+            auto lock = mutex.lock().await();
+            if (jobs.len() == 0) 
+                continue;
+
+            auto& job = jobs.front();
+            uint32_t wait = etl::time::now().tick - job.queued_at;
+            function = etl::move(job.function);
+            jobs.pop_front();
+
+            metrics.depth--;
+            metrics.busy++;
+            metrics.wait_ms_total += wait;
+            if (wait > metrics.wait_ms_max) metrics.wait_ms_max = wait;
+        }
+
+        function();
+
+        auto lock = mutex.lock().await();
+        metrics.busy--;
+        metrics.completed++;
+    }
+}
@@ -0,0 +1,73 @@
+#ifndef WIZCHIP_WORKER_POOL_H
+#define WIZCHIP_WORKER_POOL_H
+
+#include "etl/vector.h"
+#include "etl/linked_list.h"
+#include "etl/mutex.h"
+#include "etl/result.h"
+#include "cmsis_os2.h"
+#include <functional>
+
+namespace Project::wizchip {
+    /// Fixed set of threads running jobs from a bounded queue.
+    /// The threads are created once, a job only costs a queue node
+    class WorkerPool {
+    public:
+        struct Args {
+            int workers = 2;                            ///< threads, created on start.
+            int queue_size = 4;                         ///< jobs waiting for a free worker, submit fails beyond it.
+            uint32_t stack_size = 4096;                 ///< stack of each worker in bytes, an HTTP request keeps about 1.5 KB on it before its handler runs.
+            osPriority_t priority = osPriorityNormal;
+        };
+
+        struct Stats {
+            int workers;
+            int busy;                   ///< workers running a job.
+            int depth;                  ///< jobs waiting in the queue.
+            int max_depth;              ///< deepest the queue has been.
+            uint32_t completed;
+            uint32_t rejected;          ///< submits that found the queue full.
+            uint32_t wait_ms_max;       ///< longest time a job waited for a worker.
+            uint32_t wait_ms_total;     ///< divided by completed for the mean wait.
+        };
+
+        WorkerPool() { mutex.init(); }
+
+        /// disable copy constructor and assignment
+        WorkerPool(const WorkerPool&) = delete;
+        WorkerPool& operator=(const WorkerPool&) = delete;
+
+        etl::Result<void, osStatus_t> start(Args args);
+        bool isRunning() const { return threads.len() > 0; }
+
+        /// no room for another job, every worker is busy and the queue is full
+        bool full() const;
+
+        /// queue a job, false when the queue is full
+        bool submit(std::function<void()> job);
+
+        /// submit the job, the pool is started with args on first use.
+        /// Without workers in args the job gets its own etl::async thread, false when no thread takes it
+        bool dispatch(const Args& args, std::function<void()> job);
+
+        Stats stats() const;
+
+    private:
+        static void worker(void* arg);
+        void run();
+
+        struct Job {
+            std::function<void()> function;
+            uint32_t queued_at;         ///< tick of submit.
+        };
+
+        Args args;
+        etl::Vector<osThreadId_t> threads;
+        etl::LinkedList<Job> jobs;
+        mutable etl::Mutex mutex;
+        osSemaphoreId_t available = nullptr;
+        Stats metrics = {};
+    };
+}
+
+#endif // WIZCHIP_WORKER_POOL_H